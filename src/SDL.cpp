@@ -1,7 +1,153 @@
 #include "SDL.h"
 #include "systems.cpp"
+#include "hud.cpp"
 #include <iostream>
 
+// Function to read the command line options
+bool SDL::ReadOptions(int argc, char* args[])
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = args[i];
+
+		// Select the collision broad phase
+		if (option == "--broadphase" && i + 1 < argc && parse_broad_phase(args[i + 1], broadPhase))
+		{
+			++i;
+			continue;
+		}
+
+		// Set the simulation tick rate
+		if (option == "--tickrate" && i + 1 < argc && atof(args[i + 1]) > 0)
+		{
+			timestep.tick_rate = atof(args[++i]);
+			continue;
+		}
+
+		// Set the most simulation ticks run in one frame
+		if (option == "--maxsteps" && i + 1 < argc && atoi(args[i + 1]) > 0)
+		{
+			timestep.max_steps = atoi(args[++i]);
+			continue;
+		}
+
+		// Set the target frame rate, 0 removes the limit
+		if (option == "--fps" && i + 1 < argc && atof(args[i + 1]) >= 0)
+		{
+			pacer.target_fps = atof(args[++i]);
+			continue;
+		}
+
+		// Present in step with the display refresh
+		if (option == "--vsync")
+		{
+			vsync = true;
+			continue;
+		}
+
+		// Run the simulation without a window for a number of ticks
+		if (option == "--headless")
+		{
+			headless = true;
+			continue;
+		}
+		if (option == "--ticks" && i + 1 < argc && atoi(args[i + 1]) > 0)
+		{
+			headlessTicks = (std::uint64_t)atoll(args[++i]);
+			ticksGiven = true;
+			continue;
+		}
+
+		// Set the world seed, the same seed gives the same game
+		if (option == "--seed" && i + 1 < argc)
+		{
+			reg.seed = strtoull(args[++i], NULL, 10);
+			continue;
+		}
+
+		// Record the input of every tick to a file
+		if (option == "--record" && i + 1 < argc)
+		{
+			recordPath = args[++i];
+			continue;
+		}
+
+		// Replay a recorded file without a window
+		if (option == "--replay" && i + 1 < argc)
+		{
+			replayPath = args[++i];
+			continue;
+		}
+
+		// Read the key bindings from another controls file
+		if (option == "--controls" && i + 1 < argc)
+		{
+			controlsPath = args[++i];
+			controlsGiven = true;
+			continue;
+		}
+
+		// Replace the stock asteroid lanes with a scenario
+		if (option == "--scenario" && i + 1 < argc)
+		{
+			scenarioPath = args[++i];
+			continue;
+		}
+
+		// Set the threads the systems of a tick run on, 1 runs them serially
+		if (option == "--threads" && i + 1 < argc && atoi(args[i + 1]) > 0)
+		{
+			systemThreads = atoi(args[++i]);
+			continue;
+		}
+
+		// Write the schedule of the systems of a tick as Graphviz dot
+		if (option == "--schedule" && i + 1 < argc)
+		{
+			schedulePath = args[++i];
+			continue;
+		}
+
+		// Write a Chrome trace of the profiled scopes on exit
+		if (option == "--trace" && i + 1 < argc)
+		{
+			tracePath = args[++i];
+			continue;
+		}
+
+		// Print the usage if the option is not recognized
+		printf("Unknown option %s\n", option.c_str());
+		printf("Usage: AsteroidGame [--bench [view|collision|overlap|lanes|systems] [--json file] [--baseline file] [--threshold pct] [--repeat n]] [--broadphase all|grid|sap|tree] [--tickrate hz] [--maxsteps n] [--fps n] [--vsync] [--headless [--ticks n]] [--seed n] [--record file | --replay file] [--controls file] [--trace file] [--scenario file] [--threads n] [--schedule file]\n");
+		return false;
+	}
+
+	// Load the key bindings, the built-in ones stay when the default file is missing
+	if (!controls.load(controlsPath) && controlsGiven)
+	{
+		printf("Unable to read controls file %s\n", controlsPath.c_str());
+		return false;
+	}
+
+	// Load the scenario, its duration sets the length of a headless run unless --ticks was given
+	if (!scenarioPath.empty())
+	{
+		if (!scene.load(scenarioPath))
+		{
+			printf("Unable to read scenario file %s\n", scenarioPath.c_str());
+			return false;
+		}
+		if (scene.duration > 0 && ticksGiven)
+		{
+			printf("--ticks %llu overrides the scenario duration of %g s\n", (unsigned long long)headlessTicks, scene.duration);
+		}
+		else if (scene.duration > 0)
+		{
+			headlessTicks = scene.ticks(timestep.tick_rate);
+		}
+	}
+	return true;
+}
+
 // Function to start the SDL system
 bool SDL::Start()
 {
@@ -25,7 +171,7 @@ bool SDL::Start()
 	}
 
 	// Create a renderer for the window
-	gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
+	gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
 
 	// Check if renderer creation fails
 	if (gRenderer == NULL)
@@ -42,6 +188,33 @@ bool SDL::Start()
 	return true;
 }
 
+// Function to create the player and the asteroid spawners
+void SDL::CreateWorld()
+{
+	// Create the player entity
+	reg.assign<sprite_component>(player, { {0, 0, 52, 30}, textures[0], 200 });
+	reg.assign<velocity_component>(player, { 0, 0, 0.5f, 600 });
+	reg.assign<controller_component>(player, { 0, 0 });
+	reg.assign<tracking_component>(player, { entity(), true });
+	reg.assign<collision_component>(player, { layer_player });
+
+	// Create the spawners of the scenario instead of the stock lanes if one is loaded
+	if (!scenarioPath.empty())
+	{
+		for (const asteroid_component& spawner : scene.make_spawners())
+		{
+			reg.assign<asteroid_component>(create_entity(), spawner);
+		}
+		return;
+	}
+
+	// Create asteroid entities
+	reg.assign<asteroid_component>(create_entity(), { 2.0,2.0,1,0,40,40 });
+	reg.assign<asteroid_component>(create_entity(), { 5.0,1.5,-1,0,40,40 });
+	reg.assign<asteroid_component>(create_entity(), { 7.0,2.0,0,-1,40,40 });
+	reg.assign<asteroid_component>(create_entity(), { 10.0,1.5,0,1,40,40 });
+}
+
 // Function to run the game loop
 void SDL::GameLoop()
 {
@@ -53,79 +226,320 @@ void SDL::GameLoop()
 	textures.push_back(LoadTexture("../assets/bullet.png"));
 	textures.push_back(LoadTexture("../assets/asteroid.png"));
 
-	// Initialize the registry
-	registry reg;
-
 	// Initialize all systems
-	mobility_system mobility_sys;
-	sprite_system sprite_sys;
-	controller_system controller_sys;
-	velocity_system velocity_sys;
-	rotation_system rotation_sys;
-	tracking_system tracking_sys;
-	lifespan_system lifespan_sys;
-	collision_system collision_sys;
-	asteroid_system asteroid_sys;
-	input_system input_sys;
+	game_systems systems;
 
-	// Create the player entity
-	reg.sprites[player] = { {0, 0, 52, 30}, textures[0], 200 };
-	reg.velocities[player] = { 0, 0, 0.5f, 600 };
-	reg.controllers[player] = { 0, 0 };
-	reg.trackers[player] = { NULL, true };
-	reg.collisions[player] = { 'p' };
+	// Use the broad phase selected on the command line
+	systems.collision_sys.mode = broadPhase;
 
-	// Create asteroid entities
-	reg.asteroids[create_entity()] = { 2.0,2.0,1,0,40,40 };
-	reg.asteroids[create_entity()] = { 5.0,1.5,-1,0,40,40 };
-	reg.asteroids[create_entity()] = { 7.0,2.0,0,-1,40,40 };
-	reg.asteroids[create_entity()] = { 10.0,1.5,0,1,40,40 };
+	// Create the player and the asteroid spawners
+	CreateWorld();
+	WriteSchedule(systems);
+
+	// Open the replay file if the input is recorded
+	input_recorder recorder;
+	if (!recordPath.empty() && !recorder.open(recordPath, ReplayHeader()))
+	{
+		printf("Unable to create replay file %s\n", recordPath.c_str());
+	}
+
+	// Input of a tick as it is recorded, with actions in place of keys
+	tick_input recorded;
+
+	// Input waiting for the next tick
+	tick_input pending;
+
+	// Performance overlay, shown with F3
+	hud_overlay hud;
+	hud.target = pacer.target_fps > 0 ? 1 / pacer.target_fps : timestep.step();
+
+	// Start the clock
+	NOW = SDL_GetPerformanceCounter();
+	pacer.start();
 
 	// Game loop
 	while (!quit)
 	{
 		// Handle events
-		while (SDL_PollEvent(&e) != 0)
 		{
-			// Check for quit event
-			if (e.type == SDL_QUIT)
+			PROFILE_SCOPE("poll_events");
+			while (SDL_PollEvent(&e) != 0)
 			{
-				quit = true;
+				// Check for quit event
+				if (e.type == SDL_QUIT)
+				{
+					quit = true;
+				}
+
+				// Show or hide the performance overlay, it is not part of the game input
+				if (e.type == SDL_KEYDOWN && e.key.repeat == 0 && e.key.keysym.scancode == SDL_SCANCODE_F3)
+				{
+					hud.toggle();
+				}
+
+				// Keep the key events for the next tick, the systems ignore everything else
+				// only keys bound to an action get a drain time, the others never reach the simulation and would skew the latency
+				if ((e.type == SDL_KEYDOWN || e.type == SDL_KEYUP) && e.key.repeat == 0)
+				{
+					bool bound = controls.action(e.key.keysym.scancode) != action_count;
+					pending.events.push_back({ e.type, e.key.keysym.scancode, bound ? SDL_GetPerformanceCounter() : 0 });
+				}
 			}
 
-			// Update controller system
-			controller_sys.update(reg, e);
-
-			// Update input system
-			input_sys.update(reg, player, e, *this);
+			// Sample the mouse once per frame
+			SDL_GetMouseState(&pending.mouse_x, &pending.mouse_y);
 		}
 
-		// Calculate delta time
+		// Calculate the real time since the last frame
 		LAST = NOW;
-		NOW = SDL_GetTicks64();
-		deltaTime = (NOW - LAST) / 1000.0;
+		NOW = SDL_GetPerformanceCounter();
+		deltaTime = (NOW - LAST) / (double)SDL_GetPerformanceFrequency();
+		hud.frame(deltaTime);
+
+		// Run as many fixed simulation ticks as the real time allows
+		int steps = timestep.advance(deltaTime);
+		for (int i = 0; i < steps; ++i)
+		{
+			// Remember where the sprites were before the tick so the frame can be drawn between the two
+			systems.sprite_sys.snapshot(reg);
+
+			// Add the input the scenario scripts, before recording so a replay sees it too
+			scene.script(timestep.ticks - steps + i, timestep.tick_rate, controls, pending);
+
+			// Apply the input of the tick, the events go to the first tick of the frame
+			if (recorder.file != NULL)
+			{
+				recorded = pending;
+				controls.to_actions(recorded);
+				recorder.write(recorded);
+			}
+			systems.apply(*this, pending);
+			pending.events.clear();
+
+			// Update all systems
+			systems.tick(*this, timestep.step());
+		}
+
+		// End a scenario run once its duration has been simulated
+		if (scene.duration > 0 && timestep.ticks >= scene.ticks(timestep.tick_rate))
+		{
+			quit = true;
+		}
 
 		// Clear the screen
-		SDL_RenderClear(gRenderer);
+		{
+			PROFILE_SCOPE("render_clear");
+			SDL_RenderClear(gRenderer);
+		}
+
+		// Draw the sprites between the last two ticks
+		systems.sprite_sys.update(reg, gRenderer, timestep.alpha());
 
-		// Update all systems
-		asteroid_sys.update(reg, deltaTime, *this);
-		velocity_sys.update(reg, deltaTime);
-		mobility_sys.update(reg, deltaTime);
-		collision_sys.update(reg);
-		lifespan_sys.update(reg, deltaTime);
-		tracking_sys.update(reg);
-		rotation_sys.update(reg, deltaTime);
-		sprite_sys.update(reg, gRenderer);
+		// Draw the performance overlay on top
+		hud.build(reg, systems.collision_sys.tested);
+		hud.draw(gRenderer);
+
+		// Update the screen, the input applied this frame is now visible
+		{
+			PROFILE_SCOPE("render_present");
+			SDL_RenderPresent(gRenderer);
+		}
+		latency.present(SDL_GetPerformanceCounter());
+
+		// Wait for the end of the frame
+		pacer.wait();
+	}
 
-		// Update the screen
-		SDL_RenderPresent(gRenderer);
+	// Finish the recording and print the checksum a replay of it must reach
+	if (recorder.file != NULL)
+	{
+		recorder.close();
+		printf("recorded ticks=%llu checksum=%016llx\n", (unsigned long long)timestep.ticks, (unsigned long long)Checksum());
 	}
 
+	// Print the frame time statistics
+	const sample_stats& frames = pacer.frame_times;
+	printf("frames=%zu mean=%.2f ms jitter=%.2f ms p99=%.2f ms max=%.2f ms late=%zu\n", frames.count, frames.mean * 1e3, frames.stddev() * 1e3, frames.percentile(0.99) * 1e3, frames.max * 1e3, pacer.late);
+
+	// Print the input latency statistics
+	input_latency::print("queued", latency.queued);
+	input_latency::print("presented", latency.presented);
+	input_latency::print("total", latency.total);
+	input_latency::print("fire", latency.fire);
+
+	// Print where the frame time went and write the trace if asked to
+	WriteProfile();
+
 	// Close the game
 	Close();
 }
 
+// Function to run the simulation without a window
+void SDL::RunHeadless()
+{
+	// No renderer means no textures, the sprites keep null ones
+	textures.assign(3, NULL);
+
+	// Initialize all systems
+	game_systems systems;
+
+	// Use the broad phase selected on the command line
+	systems.collision_sys.mode = broadPhase;
+
+	// Create the player and the asteroid spawners
+	CreateWorld();
+	WriteSchedule(systems);
+
+	// Run the ticks back to back at the fixed step, with the input the scenario scripts
+	double step = timestep.step();
+	tick_input input;
+	std::size_t peak = 0;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (std::uint64_t tick = 0; tick < headlessTicks; ++tick)
+	{
+		scene.script(tick, timestep.tick_rate, controls, input);
+		systems.apply(*this, input);
+		input.events.clear();
+		systems.tick(*this, step);
+		peak = std::max(peak, reg.entities.size());
+	}
+	double seconds = (SDL_GetPerformanceCounter() - start) / (double)frequency;
+
+	// Report the simulation speed
+	printf("ticks=%llu step=%.4f s simulated=%.1f s real=%.3f s ticks/s=%.0f entities=%zu peak=%zu\n", (unsigned long long)headlessTicks, step, headlessTicks * step, seconds, seconds > 0 ? headlessTicks / seconds : 0.0, reg.entities.size(), peak);
+	WriteProfile();
+}
+
+// Function to replay a recorded game without a window
+bool SDL::RunReplay()
+{
+	// Read the seed and tick rate of the recording
+	input_player player_input;
+	if (!player_input.open(replayPath))
+	{
+		printf("Unable to read replay file %s\n", replayPath.c_str());
+		return false;
+	}
+	const replay_header& header = player_input.header;
+	reg.seed = header.seed;
+	timestep.tick_rate = header.tick_rate;
+	broadPhase = (broad_phase)header.broad_phase;
+
+	// The spawners are not recorded, so the replay needs the scenario the game was played with
+	if (header.scenario_hash != ReplayHeader().scenario_hash)
+	{
+		printf("Replay %s was recorded with %s%s, pass the same --scenario to replay it\n", replayPath.c_str(), header.scenario.empty() ? "the stock lanes" : "scenario ", header.scenario.c_str());
+		player_input.close();
+		return false;
+	}
+
+	// The recording holds actions, they are turned back into the built-in keys whatever --controls says
+	controls.defaults();
+
+	// No renderer means no textures, the sprites keep null ones
+	textures.assign(3, NULL);
+
+	// Initialize all systems
+	game_systems systems;
+
+	// Use the broad phase selected on the command line
+	systems.collision_sys.mode = broadPhase;
+
+	// Create the player and the asteroid spawners
+	CreateWorld();
+
+	// Feed every recorded tick back as fast as possible
+	double step = timestep.step();
+	std::uint64_t ticks = 0;
+	tick_input input;
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	Uint64 start = SDL_GetPerformanceCounter();
+	while (player_input.read(input))
+	{
+		controls.to_keys(input);
+		systems.apply(*this, input);
+		systems.tick(*this, step);
+		++ticks;
+	}
+	double seconds = (SDL_GetPerformanceCounter() - start) / (double)frequency;
+	player_input.close();
+
+	// Report the simulation speed and the checksum of the final state
+	printf("replayed ticks=%llu real=%.3f s ticks/s=%.0f checksum=%016llx\n", (unsigned long long)ticks, seconds, seconds > 0 ? ticks / seconds : 0.0, (unsigned long long)Checksum());
+	return true;
+}
+
+// Function to describe the game for a recording
+replay_header SDL::ReplayHeader()
+{
+	replay_header header;
+	header.seed = reg.seed;
+	header.tick_rate = timestep.tick_rate;
+	header.broad_phase = (std::uint8_t)broadPhase;
+	if (!scenarioPath.empty())
+	{
+		header.scenario = scenarioPath;
+		header.scenario_hash = scene.hash();
+	}
+	return header;
+}
+
+// Function to hash the state of the sprites
+Uint64 SDL::Checksum()
+{
+	// FNV-1a over the entity, position and angle of every sprite in pool order
+	Uint64 hash = 14695981039346656037ULL;
+	for (std::size_t i = 0; i < reg.sprites.size(); ++i)
+	{
+		const sprite_component& sprite = reg.sprites.components[i];
+		float values[3] = { sprite.src.x, sprite.src.y, sprite.angle };
+		unsigned char bytes[sizeof(entity) + sizeof(values)];
+		memcpy(bytes, &reg.sprites.entities[i], sizeof(entity));
+		memcpy(bytes + sizeof(entity), values, sizeof(values));
+		for (unsigned char byte : bytes)
+		{
+			hash = (hash ^ byte) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+// Function to print the profile summary and write the trace
+void SDL::WriteProfile()
+{
+#ifndef PROFILER_DISABLED
+	global_profiler().print();
+	if (!tracePath.empty())
+	{
+		if (global_profiler().write_trace(tracePath))
+		{
+			printf("trace written to %s\n", tracePath.c_str());
+		}
+		else
+		{
+			printf("Unable to create trace file %s\n", tracePath.c_str());
+		}
+	}
+#endif
+}
+
+// Function to write the schedule of a tick
+void SDL::WriteSchedule(game_systems& systems)
+{
+	if (schedulePath.empty())
+	{
+		return;
+	}
+	systems.plan(*this, timestep.step());
+	if (!systems.schedule.write_dot(schedulePath))
+	{
+		printf("Unable to create schedule file %s\n", schedulePath.c_str());
+		return;
+	}
+	printf("schedule written to %s systems=%zu levels=%d width=%d\n", schedulePath.c_str(), systems.schedule.tasks.size(), systems.schedule.depth(), systems.schedule.width());
+}
+
 // Function to close the game
 void SDL::Close()
 {
@@ -145,6 +559,8 @@ void SDL::Close()
 // Function to load a texture from a file
 SDL_Texture* SDL::LoadTexture(std::string path)
 {
+	PROFILE_SCOPE("load_texture");
+
 	// Texture to return
 	SDL_Texture* newTexture = NULL;
 
@@ -179,10 +595,6 @@ SDL_Texture* SDL::LoadTexture(std::string path)
 
 entity SDL::create_entity()
 {
-	// Initializes entity count
-	static entity entities = 0;
-	// Increments entity count
-	++entities;
-	// Returns entity count
-	return entities;
+	// Returns a new or recycled entity handle from the registry
+	return reg.create();
 }
\ No newline at end of file
@@ -4,44 +4,269 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
-#include <unordered_map>
 #include <iostream>
+#include <algorithm>
 #include "components.cpp"
+#include "storage.cpp"
+#include "commands.cpp"
+#include "broadphase.cpp"
+#include "timing.cpp"
+#include "replay.cpp"
+#include "input.cpp"
+#include "profiler.cpp"
+#include "scenario.cpp"
 
-// Define an entity as a size_t type
-using entity = std::size_t;
+// component_pool numbers the component pools of the registry, each one owns a bit of the entity signatures
+enum component_pool
+{
+	sprite_pool,
+	movement_pool,
+	controller_pool,
+	velocity_pool,
+	rotation_pool,
+	tracking_pool,
+	lifespan_pool,
+	collision_pool,
+	asteroid_pool,
+	pool_count
+};
 
 // registry struct holds all the component data for entities
 struct registry
 {
-	// Map entity to sprite_component
-	std::unordered_map<entity, sprite_component> sprites;
+	// Hands out entity handles and recycles destroyed ones
+	entity_manager entities;
+
+	// Bitmask of the pools each entity index owns a component in
+	std::vector<std::uint32_t> signatures;
+
+	// Structural changes recorded by systems, applied by flush
+	command_buffer commands;
+
+	// World seed, every random stream of the simulation is derived from it
+	std::uint64_t seed = 1;
+
+	// Packed sprite_component storage
+	sparse_set<sprite_component> sprites;
+
+	// Packed movement_component storage
+	sparse_set<movement_component> movements;
+
+	// Packed controller_component storage
+	sparse_set<controller_component> controllers;
+
+	// Packed velocity_component storage
+	sparse_set<velocity_component> velocities;
+
+	// Packed rotation_component storage
+	sparse_set<rotation_component> rotations;
+
+	// Packed tracking_component storage
+	sparse_set<tracking_component> trackers;
+
+	// Packed lifespan_component storage
+	sparse_set<lifespan_component> lifespans;
 
-	// Map entity to movement_component
-	std::unordered_map<entity, movement_component> movements;
+	// Packed collision_component storage
+	sparse_set<collision_component> collisions;
 
-	// Map entity to controller_component
-	std::unordered_map<entity, controller_component> controllers;
+	// Packed asteroid_component storage
+	sparse_set<asteroid_component> asteroids;
 
-	// Map entity to velocity_component
-	std::unordered_map<entity, velocity_component> velocities;
+	registry()
+	{
+		sprites.signature_bit = 1u << sprite_pool;
+		movements.signature_bit = 1u << movement_pool;
+		controllers.signature_bit = 1u << controller_pool;
+		velocities.signature_bit = 1u << velocity_pool;
+		rotations.signature_bit = 1u << rotation_pool;
+		trackers.signature_bit = 1u << tracking_pool;
+		lifespans.signature_bit = 1u << lifespan_pool;
+		collisions.signature_bit = 1u << collision_pool;
+		asteroids.signature_bit = 1u << asteroid_pool;
+	}
 
-	// Map entity to rotation_component
-	std::unordered_map<entity, rotation_component> rotations;
+	// Creates a new entity and returns its handle
+	entity create()
+	{
+		entity id = entities.create();
+		if (entity_index(id) >= signatures.size())
+		{
+			signatures.resize(entity_index(id) + 1, 0);
+		}
+		return id;
+	}
 
-	// Map entity to tracking_component
-	std::unordered_map<entity, tracking_component> trackers;
+	// Returns true if the entity has not been destroyed
+	// @param id is the entity handle
+	bool alive(entity id) const
+	{
+		return entities.alive(id);
+	}
 
-	// Map entity to lifespan_component
-	std::unordered_map<entity, lifespan_component> lifespans;
+	// Returns the random stream of an entity, the same seed and entity always give the same numbers
+	// @param id is the entity owning the stream
+	pcg32 stream(entity id) const
+	{
+		return pcg32(seed, id);
+	}
 
-	// Map entity to collision_component
-	std::unordered_map<entity, collision_component> collisions;
+	// Adds a component to an entity or overwrites the one it already has, and records it in the signature
+	// @param id is the entity receiving the component
+	// @param value is the component data
+	template <typename T>
+	T& assign(entity id, const T& value)
+	{
+		sparse_set<T>& set = pool<T>();
+		std::uint32_t index = entity_index(id);
+		if (index >= signatures.size())
+		{
+			signatures.resize(index + 1, 0);
+		}
+		signatures[index] |= set.signature_bit;
+		return set.emplace(id, value);
+	}
 
-	// Map entity to asteroid_component
-	std::unordered_map<entity, asteroid_component> asteroids;
+	// Removes a component from an entity and clears it from the signature
+	// @param id is the entity losing the component
+	template <typename T>
+	void remove(entity id)
+	{
+		sparse_set<T>& set = pool<T>();
+		if (!set.contains(id))
+		{
+			return;
+		}
+		signatures[entity_index(id)] &= ~set.signature_bit;
+		set.erase(id);
+	}
+
+	// Destroys an entity and removes every component it owns
+	// @param id is the entity to destroy
+	void destroy(entity id)
+	{
+		destroy(&id, &id + 1);
+	}
+
+	// Destroys a range of entities, walking one pool at a time and only touching the pools each entity owns
+	// entities that are already destroyed or appear twice in the range are skipped
+	// @param first is the start of the range of entities
+	// @param last is the end of the range of entities
+	template <typename It>
+	void destroy(It first, It last)
+	{
+		erase_owned(sprites, first, last);
+		erase_owned(movements, first, last);
+		erase_owned(controllers, first, last);
+		erase_owned(velocities, first, last);
+		erase_owned(rotations, first, last);
+		erase_owned(trackers, first, last);
+		erase_owned(lifespans, first, last);
+		erase_owned(collisions, first, last);
+		erase_owned(asteroids, first, last);
+		for (It it = first; it != last; ++it)
+		{
+			if (alive(*it))
+			{
+				signatures[entity_index(*it)] = 0;
+				entities.destroy(*it);
+			}
+		}
+	}
+
+	// Erases the components of a set owned by the living entities of a range
+	template <typename T, typename It>
+	void erase_owned(sparse_set<T>& set, It first, It last)
+	{
+		for (It it = first; it != last; ++it)
+		{
+			if (alive(*it) && (signatures[entity_index(*it)] & set.signature_bit) != 0)
+			{
+				set.erase(*it);
+			}
+		}
+	}
+
+	// Applies the changes recorded in the command buffer in one batched pass
+	// the additions and removals of each component type are applied first, then the destructions
+	void flush()
+	{
+		PROFILE_SCOPE("flush");
+		flush_changes<sprite_component>();
+		flush_changes<movement_component>();
+		flush_changes<controller_component>();
+		flush_changes<velocity_component>();
+		flush_changes<rotation_component>();
+		flush_changes<tracking_component>();
+		flush_changes<lifespan_component>();
+		flush_changes<collision_component>();
+		flush_changes<asteroid_component>();
+		if (!commands.destroyed.empty())
+		{
+			std::vector<entity>& destroyed = commands.destroyed;
+			std::sort(destroyed.begin(), destroyed.end(), [](entity a, entity b) { return entity_index(a) < entity_index(b); });
+			destroyed.erase(std::unique(destroyed.begin(), destroyed.end()), destroyed.end());
+			destroy(destroyed.begin(), destroyed.end());
+			destroyed.clear();
+		}
+	}
+
+	// Applies the recorded additions and removals of one component type
+	// the changes are sorted by entity index so the pool is written in ascending order,
+	// and the changes to the same entity are coalesced into the last one recorded, so a removal after an addition wins and the other way round
+	template <typename T>
+	void flush_changes()
+	{
+		std::vector<pending_change<T>>& changes = commands.queue<T>().changes;
+		if (changes.empty())
+		{
+			return;
+		}
+		std::stable_sort(changes.begin(), changes.end(), [](const pending_change<T>& a, const pending_change<T>& b) { return entity_index(a.id) < entity_index(b.id); });
+		for (std::size_t i = 0; i < changes.size(); ++i)
+		{
+			const pending_change<T>& change = changes[i];
+			if (i + 1 < changes.size() && changes[i + 1].id == change.id)
+			{
+				continue;
+			}
+			if (change.assigned && alive(change.id))
+			{
+				assign<T>(change.id, change.value);
+			}
+			else if (!change.assigned)
+			{
+				remove<T>(change.id);
+			}
+		}
+		changes.clear();
+	}
+
+	// Returns the pool storing components of type T
+	template <typename T>
+	sparse_set<T>& pool();
+
+	// Returns a view over every entity owning all of the component types Ts
+	template <typename... Ts>
+	component_view<Ts...> view()
+	{
+		return component_view<Ts...>(pool<Ts>()...);
+	}
 };
 
+template <> inline sparse_set<sprite_component>& registry::pool<sprite_component>() { return sprites; }
+template <> inline sparse_set<movement_component>& registry::pool<movement_component>() { return movements; }
+template <> inline sparse_set<controller_component>& registry::pool<controller_component>() { return controllers; }
+template <> inline sparse_set<velocity_component>& registry::pool<velocity_component>() { return velocities; }
+template <> inline sparse_set<rotation_component>& registry::pool<rotation_component>() { return rotations; }
+template <> inline sparse_set<tracking_component>& registry::pool<tracking_component>() { return trackers; }
+template <> inline sparse_set<lifespan_component>& registry::pool<lifespan_component>() { return lifespans; }
+template <> inline sparse_set<collision_component>& registry::pool<collision_component>() { return collisions; }
+template <> inline sparse_set<asteroid_component>& registry::pool<asteroid_component>() { return asteroids; }
+
+// game_systems runs the systems of a tick, defined in systems.cpp
+struct game_systems;
+
 // SDL class represents the game window and handles the game loop
 class SDL
 {
@@ -52,28 +277,110 @@ public:
 	// Boolean flag to indicate if the game should quit
 	bool quit = false;
 
-	// Current time in milliseconds
-	Uint64 NOW = SDL_GetTicks64();
+	// Current time in performance counter ticks
+	Uint64 NOW = SDL_GetPerformanceCounter();
 
-	// Previous time in milliseconds
+	// Previous time in performance counter ticks
 	Uint64 LAST = 0;
 
-	// Time difference between frames
+	// Real time difference between frames in seconds
 	double deltaTime = 0;
 
+	// Fixed simulation step, the systems advance by timestep.step() as many times as the real time allows
+	fixed_timestep timestep;
+
+	// Frame pacer holding the loop to its target frame rate
+	frame_pacer pacer;
+
+	// Ask the renderer to wait for the display refresh when presenting
+	bool vsync = false;
+
+	// Run the simulation without a window, renderer or textures
+	bool headless = false;
+
+	// Number of ticks the headless simulation runs, and whether it was given on the command line
+	std::uint64_t headlessTicks = 36000;
+	bool ticksGiven = false;
+
+	// Input of the current tick, the systems read it instead of asking SDL
+	input_snapshot input;
+
+	// Input latency from draining key events to presenting the frames that show them
+	input_latency latency;
+
+	// Key bindings turning key events into actions
+	action_map controls;
+
+	// Scenario replacing the stock asteroid lanes, used when scenarioPath is set
+	scenario scene;
+	std::string scenarioPath;
+
+	// File the Chrome trace of the profiled scopes is written to on exit, empty for none
+	std::string tracePath;
+
+	// Threads the systems of a tick run on, 1 runs them serially and 0 uses one per core up to the most that can run at once
+	int systemThreads = 0;
+
+	// File the dependency graph of the systems of a tick is written to at the start, empty for none
+	std::string schedulePath;
+
+	// File the key bindings are read from, and whether it was given on the command line
+	std::string controlsPath = "../assets/controls.cfg";
+	bool controlsGiven = false;
+
+	// File the input of every tick is recorded to, empty when not recording
+	std::string recordPath;
+
+	// File whose input is replayed headless, empty when not replaying
+	std::string replayPath;
+
 	// Game window size
 	static const int SCREEN_WIDTH = 720;
 	static const int SCREEN_HEIGHT = 480;
 
+	// Broad phase used by the collision system
+	broad_phase broadPhase = broad_phase_grid;
+
+	// Registry holding the entities and their components
+	registry reg;
+
 	// Create a new entity and return its unique identifier
 	entity create_entity();
 
+	// Read the command line options, returns false if one is not recognized
+	// @param argc is the number of arguments
+	// @param args is the list of arguments
+	bool ReadOptions(int argc, char* args[]);
+
 	// Initialize SDL and create the game window
 	bool Start();
 
+	// Create the player and the asteroid spawners
+	void CreateWorld();
+
 	// Main game loop that updates and renders the game
 	void GameLoop();
 
+	// Run headlessTicks simulation ticks as fast as possible and print the ticks per second
+	void RunHeadless();
+
+	// Run the ticks recorded in replayPath as fast as possible and print the ticks per second
+	// returns false if the file cannot be read
+	bool RunReplay();
+
+	// Print the time spent in every profiled scope and write the Chrome trace to tracePath if it is set
+	void WriteProfile();
+
+	// Returns the header a recording of the game starts with
+	replay_header ReplayHeader();
+
+	// Write the schedule of a tick to schedulePath as Graphviz dot if it is set
+	// @param systems are the systems whose schedule is written
+	void WriteSchedule(game_systems& systems);
+
+	// Returns a hash of every sprite's entity, position and angle, equal for two identical games
+	Uint64 Checksum();
+
 	// Close the game window and clean up resources
 	void Close();
 
@@ -0,0 +1,14 @@
+#include "SDL.h"
+#include "benchmarks.cpp"
+
+// The benchmarks on their own, without the game, so they build and run on a machine without a display or GPU
+// takes the same options as AsteroidGame --bench
+int main(int argc, char* args[])
+{
+	benchmark_options options;
+	if (!read_benchmark_options(argc, args, 1, options))
+	{
+		return 1;
+	}
+	return run_benchmarks(options);
+}
\ No newline at end of file
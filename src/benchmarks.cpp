@@ -0,0 +1,827 @@
+#pragma once
+#include <chrono>
+#include <unordered_map>
+#include <random>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <iterator>
+#include "SDL.h"
+#include "systems.cpp"
+#include "random.cpp"
+
+// benchmark_clock returns a monotonic time in seconds used to time benchmark runs
+inline double benchmark_clock()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// view_benchmark compares the velocity update written against hashed find() and operator[] lookups
+// with the same update done by velocity_system through a component view
+// @param count is the number of entities in the population
+// @param frames is the number of updates timed per run
+struct view_benchmark
+{
+	void run(std::size_t count, int frames)
+	{
+		const double deltaTime = 1.0 / 60.0;
+
+		// Build the population the way the registry stored it before sparse sets
+		std::unordered_map<entity, sprite_component> sprites;
+		std::unordered_map<entity, velocity_component> velocities;
+		std::unordered_map<entity, controller_component> controllers;
+
+		// Build the same population in the registry
+		registry reg;
+
+		for (entity id = 1; id <= count; ++id)
+		{
+			sprites[id] = { {0, 0, 10, 10}, NULL, 0 };
+			velocities[id] = { 0, 0, 0.5f, 600 };
+			controllers[id] = { 1, 0 };
+			reg.sprites.emplace(id, { {0, 0, 10, 10}, NULL, 0 });
+			reg.velocities.emplace(id, { 0, 0, 0.5f, 600 });
+			reg.controllers.emplace(id, { 1, 0 });
+		}
+
+		double start = benchmark_clock();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (auto& it : velocities)
+			{
+				if (sprites.find(it.first) == sprites.end())
+				{
+					continue;
+				}
+				if (controllers.find(it.first) == controllers.end())
+				{
+					continue;
+				}
+
+				it.second.vel_x += controllers[it.first].controller_x * deltaTime * it.second.speed;
+				it.second.vel_y += controllers[it.first].controller_y * deltaTime * it.second.speed;
+
+				it.second.vel_x *= pow(it.second.drag, deltaTime);
+				it.second.vel_y *= pow(it.second.drag, deltaTime);
+
+				sprites[it.first].src.x += it.second.vel_x * deltaTime;
+				sprites[it.first].src.y += it.second.vel_y * deltaTime;
+			}
+		}
+		double lookup = benchmark_clock() - start;
+
+		velocity_system velocity_sys;
+		start = benchmark_clock();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			velocity_sys.update(reg, deltaTime);
+		}
+		double view = benchmark_clock() - start;
+
+		double scale = 1e9 / ((double)count * frames);
+		printf("velocity_system entities=%zu unordered_map=%.2f ns/entity view=%.2f ns/entity\n", count, lookup * scale, view * scale);
+	}
+};
+
+// collision_benchmark times collision_system with each broad phase on a field of colliders whose
+// density stays the same as the count grows, so a linear broad phase keeps a constant cost per collider
+// the quadratic loop is timed once testing one pair at a time, the reference the broad phases are measured against,
+// and once with the fastest overlap kernel
+// @param count is the number of colliders
+// @param frames is the number of updates timed per broad phase
+struct collision_benchmark
+{
+	// all_pairs_limit is the largest count the quadratic loop is timed at
+	std::size_t all_pairs_limit = 10000;
+
+	void run(std::size_t count, int frames)
+	{
+		registry reg;
+		std::mt19937 random(1234);
+		float side = (float)std::sqrt((double)count) * 60;
+		std::uniform_real_distribution<float> position(0, side);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			entity id = reg.create();
+			reg.assign<sprite_component>(id, { {position(random), position(random), 40, 40}, NULL, 0 });
+			reg.assign<collision_component>(id, { i % 10 == 0 ? (std::uint32_t)layer_bullet : (std::uint32_t)layer_asteroid });
+		}
+
+		printf("collision_system colliders=%zu", count);
+		time_mode(reg, broad_phase_grid, "grid", count, frames);
+		time_mode(reg, broad_phase_sweep_and_prune, "sap", count, frames);
+		time_mode(reg, broad_phase_aabb_tree, "tree", count, frames);
+		if (count <= all_pairs_limit)
+		{
+			time_mode(reg, broad_phase_all_pairs, "all_pairs_scalar", count, frames, overlap_scalar);
+			time_mode(reg, broad_phase_all_pairs, "all_pairs", count, frames);
+		}
+		else
+		{
+			printf(" all_pairs=skipped");
+		}
+		printf("\n");
+	}
+
+	// Times one broad phase and prints the time per collider
+	// @param kernel is the overlap kernel the all pairs loop tests with
+	void time_mode(registry& reg, broad_phase mode, const char* name, std::size_t count, int frames, overlap_kernel kernel = detect_overlap_kernel())
+	{
+		collision_system collision_sys;
+		collision_sys.mode = mode;
+		collision_sys.kernel = kernel;
+		double total = 0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			double start = benchmark_clock();
+			collision_sys.update(reg);
+			total += benchmark_clock() - start;
+			// Drop the recorded collision results so every frame sees the same field
+			reg.commands = command_buffer();
+		}
+		printf(" %s=%.2f ns/collider", name, total * 1e9 / ((double)count * frames));
+	}
+};
+
+// lane_benchmark replays the four asteroid lanes set up in SDL::GameLoop, each copied several times and
+// spawning every frame, with a player in the middle of the screen for every copy firing bullets around it,
+// and times collision_system on the resulting streams with each broad phase
+// asteroids never react to each other, so the bullets and the players give the broad phases the pairs to report
+// @param copies is the number of spawners per lane
+// @param frames is the number of frames timed once the lanes are full
+struct lane_benchmark
+{
+	void run(int copies, int frames)
+	{
+		printf("lanes spawners=%d", copies * 4);
+		std::size_t population = 0;
+		time_mode(broad_phase_all_pairs, "all_pairs", copies, frames, population);
+		time_mode(broad_phase_grid, "grid", copies, frames, population);
+		time_mode(broad_phase_sweep_and_prune, "sap", copies, frames, population);
+		time_mode(broad_phase_aabb_tree, "tree", copies, frames, population);
+		printf(" colliders=%zu\n", population);
+	}
+
+	// Simulates the lanes with one broad phase and prints the collision time per frame
+	void time_mode(broad_phase mode, const char* name, int copies, int frames, std::size_t& population)
+	{
+		const double deltaTime = 1.0 / 60.0;
+		SDL sdl;
+		sdl.textures.assign(3, NULL);
+		registry& reg = sdl.reg;
+		for (int i = 0; i < copies; ++i)
+		{
+			reg.assign<asteroid_component>(reg.create(), { 0, 0, 1, 0, 40, 40 });
+			reg.assign<asteroid_component>(reg.create(), { 0, 0, -1, 0, 40, 40 });
+			reg.assign<asteroid_component>(reg.create(), { 0, 0, 0, -1, 40, 40 });
+			reg.assign<asteroid_component>(reg.create(), { 0, 0, 0, 1, 40, 40 });
+		}
+
+		std::vector<entity> players(copies, entity());
+
+		asteroid_system asteroid_sys;
+		mobility_system mobility_sys;
+		collision_system collision_sys;
+		lifespan_system lifespan_sys;
+		collision_sys.mode = mode;
+		// Asteroids live for 5 seconds, so the lanes are full after 300 frames
+		const int fill = 300;
+		double total = 0;
+		std::size_t tested = 0;
+		for (int frame = 0; frame < fill + frames; ++frame)
+		{
+			for (int i = 0; i < copies; ++i)
+			{
+				// Put back the players the asteroids destroyed
+				if (!reg.alive(players[i]))
+				{
+					players[i] = reg.create();
+					reg.assign<sprite_component>(players[i], { { sdl.SCREEN_WIDTH / 2.0f - 26, sdl.SCREEN_HEIGHT / 2.0f - 15, 52, 30 }, NULL, 0 });
+					reg.assign<collision_component>(players[i], { layer_player });
+				}
+
+				// Fire ten bullets a second from each player, turning by the golden angle between shots
+				if ((frame + i) % 6 == 0)
+				{
+					float angle = (float)((frame / 6 * copies + i) * 2.39996323);
+					entity bullet = reg.create();
+					reg.assign<sprite_component>(bullet, { { sdl.SCREEN_WIDTH / 2.0f - 7, sdl.SCREEN_HEIGHT / 2.0f - 5.5f, 14, 11 }, NULL, 0 });
+					reg.assign<movement_component>(bullet, { std::cos(angle), std::sin(angle), 700 });
+					reg.assign<lifespan_component>(bullet, { 1 });
+					reg.assign<collision_component>(bullet, { layer_bullet, true });
+				}
+			}
+			asteroid_sys.update(reg, deltaTime, sdl);
+			mobility_sys.update(reg, deltaTime);
+			if (frame == fill)
+			{
+				collision_sys.tree.reset_metrics();
+			}
+			double start = benchmark_clock();
+			collision_sys.update(reg, deltaTime);
+			if (frame >= fill)
+			{
+				total += benchmark_clock() - start;
+				tested += collision_sys.tested;
+			}
+			reg.flush();
+			lifespan_sys.update(reg, deltaTime);
+			reg.flush();
+		}
+		population = reg.collisions.size();
+		printf(" %s=%.3f ms/frame (pairs=%.0f/frame)", name, total * 1e3 / frames, (double)tested / frames);
+		if (mode == broad_phase_aabb_tree)
+		{
+			const aabb_tree& tree = collision_sys.tree;
+			printf(" (height=%d balance=%d area_ratio=%.1f reinserts=%.1f/frame rotations=%.1f/frame)", tree.height(), tree.max_balance(), tree.area_ratio(), (double)tree.reinserts / frames, (double)tree.rotations / frames);
+		}
+	}
+};
+
+// overlap_benchmark tests every box of a random field against all the boxes after it, once one pair at a
+// time through SDL_HasIntersectionF and once with each overlap kernel the processor supports
+// @param count is the number of boxes
+// @param runs is the number of times the field is tested
+struct overlap_benchmark
+{
+	void run(std::size_t count, int runs)
+	{
+		std::mt19937 random(1234);
+		float side = (float)std::sqrt((double)count) * 60;
+		std::uniform_real_distribution<float> position(0, side);
+		std::vector<SDL_FRect> rects;
+		std::vector<aabb> boxes;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			SDL_FRect rect = { position(random), position(random), 40, 40 };
+			rects.push_back(rect);
+			boxes.push_back(make_aabb(rect));
+		}
+		aabb_soa soa;
+		soa.assign(boxes);
+		double tests = (double)count * (count - 1) / 2 * runs;
+
+		std::size_t expected = 0;
+		double start = benchmark_clock();
+		for (int run = 0; run < runs; ++run)
+		{
+			expected = 0;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				for (std::size_t j = i + 1; j < count; ++j)
+				{
+					expected += SDL_HasIntersectionF(&rects[i], &rects[j]) ? 1 : 0;
+				}
+			}
+		}
+		printf("overlap boxes=%zu SDL_HasIntersectionF=%.3f ns/test", count, (benchmark_clock() - start) * 1e9 / tests);
+
+		overlap_kernel widest = detect_overlap_kernel();
+		std::vector<std::uint32_t> hits;
+		for (int kernel = overlap_scalar; kernel <= widest; ++kernel)
+		{
+			std::size_t found = 0;
+			start = benchmark_clock();
+			for (int run = 0; run < runs; ++run)
+			{
+				found = 0;
+				for (std::uint32_t i = 0; i < count; ++i)
+				{
+					hits.clear();
+					overlap_range((overlap_kernel)kernel, boxes[i], soa, i + 1, (std::uint32_t)count, hits);
+					found += hits.size();
+				}
+			}
+			double elapsed = benchmark_clock() - start;
+			printf(" %s=%.3f ns/test", overlap_kernel_name((overlap_kernel)kernel), elapsed * 1e9 / tests);
+			if (found != expected)
+			{
+				printf(" (found %zu overlaps, expected %zu)", found, expected);
+			}
+		}
+		printf(" overlaps=%zu\n", expected);
+	}
+};
+
+// benchmark_result is the timing of one system on one population, as written to the JSON report
+struct benchmark_result
+{
+	// name is the system, mix is the share of the population the system works on, or "replay" for game_tick
+	std::string name;
+	std::string mix;
+	std::size_t entities;
+	int frames;
+	// median_ms and mean_ms are the time of one update in milliseconds
+	double median_ms;
+	double mean_ms;
+	// ns_per_entity is the median update time divided by the population
+	double ns_per_entity;
+	// repetitions is the number of times the population was built and timed
+	int repetitions;
+	// ci_low_ms and ci_high_ms bound the median with 95% confidence
+	double ci_low_ms;
+	double ci_high_ms;
+};
+
+// Returns the median of samples and bounds it with 95% confidence by resampling them with replacement
+// the bootstrap makes no assumption about the shape of the timings, which are usually skewed by outliers
+// @param samples are the timings, reordered by the call
+// @param low and high receive the bounds
+inline double median_confidence(std::vector<double>& samples, double& low, double& high)
+{
+	const int resamples = 200;
+	std::size_t n = samples.size();
+	std::nth_element(samples.begin(), samples.begin() + n / 2, samples.end());
+	double median = samples[n / 2];
+
+	// A fixed stream keeps the bounds the same for the same samples
+	pcg32 random;
+	random.seed(1234, 1);
+	std::vector<double> medians;
+	std::vector<double> resample(n);
+	for (int i = 0; i < resamples; ++i)
+	{
+		for (std::size_t j = 0; j < n; ++j)
+		{
+			resample[j] = samples[random.bounded((std::uint32_t)n)];
+		}
+		std::nth_element(resample.begin(), resample.begin() + n / 2, resample.end());
+		medians.push_back(resample[n / 2]);
+	}
+	std::sort(medians.begin(), medians.end());
+	low = medians[(std::size_t)(resamples * 0.025)];
+	high = medians[(std::size_t)(resamples * 0.975)];
+	return median;
+}
+
+// Writes benchmark results as JSON, returns false if the file cannot be created
+// @param path is the file to write
+// @param results are the results to write
+inline bool write_benchmark_json(const std::string& path, const std::vector<benchmark_result>& results)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+	fprintf(file, "{\n  \"benchmarks\": [");
+	for (std::size_t i = 0; i < results.size(); ++i)
+	{
+		const benchmark_result& result = results[i];
+		fprintf(file, "%s\n    {\"name\": \"%s\", \"mix\": \"%s\", \"entities\": %zu, \"frames\": %d, \"repetitions\": %d, \"median_ms\": %.6f, \"ci_low_ms\": %.6f, \"ci_high_ms\": %.6f, \"mean_ms\": %.6f, \"ns_per_entity\": %.3f}",
+			i == 0 ? "" : ",", result.name.c_str(), result.mix.c_str(), result.entities, result.frames, result.repetitions, result.median_ms, result.ci_low_ms, result.ci_high_ms, result.mean_ms, result.ns_per_entity);
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return true;
+}
+
+// Returns the text after "key": in a line of a benchmark file, with the quotes of a string removed
+inline std::string json_field(const std::string& line, const std::string& key)
+{
+	std::size_t at = line.find("\"" + key + "\": ");
+	if (at == std::string::npos)
+	{
+		return "";
+	}
+	at += key.size() + 4;
+	if (line[at] == '"')
+	{
+		return line.substr(at + 1, line.find('"', at + 1) - at - 1);
+	}
+	return line.substr(at, line.find_first_of(",}", at) - at);
+}
+
+// Reads the results written by write_benchmark_json, one result per line, returns false if the file cannot be opened
+// @param path is the file to read
+// @param results receives the results
+inline bool read_benchmark_json(const std::string& path, std::vector<benchmark_result>& results)
+{
+	FILE* file = fopen(path.c_str(), "r");
+	if (file == NULL)
+	{
+		return false;
+	}
+	char buffer[1024];
+	while (fgets(buffer, sizeof(buffer), file) != NULL)
+	{
+		std::string line = buffer;
+		if (json_field(line, "name").empty())
+		{
+			continue;
+		}
+		benchmark_result result;
+		result.name = json_field(line, "name");
+		result.mix = json_field(line, "mix");
+		result.entities = (std::size_t)atoll(json_field(line, "entities").c_str());
+		result.frames = atoi(json_field(line, "frames").c_str());
+		result.repetitions = atoi(json_field(line, "repetitions").c_str());
+		result.median_ms = atof(json_field(line, "median_ms").c_str());
+		result.ci_low_ms = atof(json_field(line, "ci_low_ms").c_str());
+		result.ci_high_ms = atof(json_field(line, "ci_high_ms").c_str());
+		result.mean_ms = atof(json_field(line, "mean_ms").c_str());
+		result.ns_per_entity = atof(json_field(line, "ns_per_entity").c_str());
+		results.push_back(result);
+	}
+	fclose(file);
+	return true;
+}
+
+// Compares results against a baseline and prints the change of every benchmark, returns the number of regressions, or -1
+// when the baseline is refused
+// a benchmark regresses when its median is slower than the baseline's by more than the threshold and the two
+// confidence intervals do not overlap, so noise alone does not trip it
+// @param baseline are the stored results
+// @param current are the results of this run
+// a baseline recorded with a single repetition has no spread to bound its medians with and is refused
+// @param threshold is the allowed slowdown, 0.1 for 10%
+inline int compare_benchmarks(const std::vector<benchmark_result>& baseline, const std::vector<benchmark_result>& current, double threshold)
+{
+	for (const benchmark_result& base : baseline)
+	{
+		if (base.repetitions < 2)
+		{
+			printf("Baseline %s mix=%s entities=%zu was recorded with %d repetition, record it again with --repeat 5\n", base.name.c_str(), base.mix.c_str(), base.entities, base.repetitions);
+			return -1;
+		}
+	}
+
+	int regressions = 0;
+	for (const benchmark_result& now : current)
+	{
+		const benchmark_result* base = nullptr;
+		for (const benchmark_result& candidate : baseline)
+		{
+			if (candidate.name == now.name && candidate.mix == now.mix && candidate.entities == now.entities)
+			{
+				base = &candidate;
+			}
+		}
+		if (base == nullptr)
+		{
+			printf("compare %s mix=%s entities=%zu now=%.4f ms new\n", now.name.c_str(), now.mix.c_str(), now.entities, now.median_ms);
+			continue;
+		}
+		double delta = base->median_ms > 0 ? now.median_ms / base->median_ms - 1 : 0;
+		const char* status = "ok";
+		if (delta > threshold && now.ci_low_ms > base->ci_high_ms)
+		{
+			status = "REGRESSION";
+			++regressions;
+		}
+		else if (delta < -threshold && now.ci_high_ms < base->ci_low_ms)
+		{
+			status = "faster";
+		}
+		printf("compare %s mix=%s entities=%zu base=%.4f ms [%.4f, %.4f] now=%.4f ms [%.4f, %.4f] delta=%+.1f%% %s\n", now.name.c_str(), now.mix.c_str(), now.entities,
+			base->median_ms, base->ci_low_ms, base->ci_high_ms, now.median_ms, now.ci_low_ms, now.ci_high_ms, delta * 100, status);
+	}
+	printf("compare benchmarks=%zu regressions=%d threshold=%.1f%%\n", current.size(), regressions, threshold * 100);
+	return regressions;
+}
+
+// system_benchmark times every simulation system of systems.cpp on its own, on synthetic populations
+// every population is a field of sprites of the same density, and a mix decides how many of them
+// carry the components the system works on, the others carry a controller_component the system ignores
+struct system_benchmark
+{
+	// results collects the timings of every benchmark for the JSON report
+	std::vector<benchmark_result> results;
+	// medians holds the median update time of every repetition of every benchmark, in the order of results
+	std::vector<std::vector<double>> medians;
+	// slot is the benchmark of results the next timing belongs to
+	std::size_t slot = 0;
+
+	// Runs the whole suite a number of times and fills results
+	// each repetition runs every benchmark once, so noise that lasts a while on a busy machine
+	// spoils one repetition of many benchmarks rather than every repetition of one
+	// @param repetitions is the number of times the suite runs
+	void run_all(int repetitions)
+	{
+		for (int repetition = 0; repetition < repetitions; ++repetition)
+		{
+			// From a hundred to a million entities, with fewer updates as the population grows
+			slot = 0;
+			for (std::size_t count = 100; count <= 1000000; count *= 10)
+			{
+				run(count, (int)std::max<std::size_t>(5, std::min<std::size_t>(1000, 10000000 / (count * 10))));
+			}
+			time_game("../assets/replays/game_tick.replay");
+		}
+
+		// Summarize the repetitions of every benchmark
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			benchmark_result& result = results[i];
+			double low, high;
+			double median = median_confidence(medians[i], low, high);
+			result.repetitions = repetitions;
+			result.median_ms = median * 1e3;
+			result.ci_low_ms = low * 1e3;
+			result.ci_high_ms = high * 1e3;
+			result.ns_per_entity = median * 1e9 / result.entities;
+			printf("%s mix=%s entities=%zu median=%.4f ms [%.4f, %.4f] mean=%.4f ms %.2f ns/entity\n", result.name.c_str(), result.mix.c_str(), result.entities,
+				result.median_ms, result.ci_low_ms, result.ci_high_ms, result.mean_ms, result.ns_per_entity);
+		}
+	}
+
+	// Times every system on one population size, in both mixes
+	// @param count is the number of entities in the population
+	// @param frames is the number of updates timed per system and mix
+	void run(std::size_t count, int frames)
+	{
+		const double deltaTime = 1.0 / 60.0;
+		const char* mixes[2] = { "all", "quarter" };
+		const std::size_t every[2] = { 1, 4 };
+		for (int mix = 0; mix < 2; ++mix)
+		{
+			mobility_system mobility_sys;
+			time_system("mobility_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t) { reg.assign<movement_component>(id, { 1, 1, 200 }); },
+				[&](SDL& sdl) { mobility_sys.update(sdl.reg, deltaTime); });
+
+			velocity_system velocity_sys;
+			time_system("velocity_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t) { reg.assign<velocity_component>(id, { 0, 0, 0.5f, 600 }); reg.assign<controller_component>(id, { 1, 0 }); },
+				[&](SDL& sdl) { velocity_sys.update(sdl.reg, deltaTime); });
+
+			rotation_system rotation_sys;
+			time_system("rotation_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t) { reg.assign<rotation_component>(id, { 1 }); },
+				[&](SDL& sdl) { rotation_sys.update(sdl.reg, deltaTime); });
+
+			// Half the trackers follow the mouse, the others the tracker set up before them
+			tracking_system tracking_sys;
+			time_system("tracking_system", mixes[mix], count, every[mix], frames,
+				[previous = entity()](registry& reg, entity id, std::size_t i) mutable { reg.assign<tracking_component>(id, { previous, i % 2 == 0 }); previous = id; },
+				[&](SDL& sdl) { tracking_sys.update(sdl.reg, 360, 240); });
+
+			// Nothing expires while it is timed
+			lifespan_system lifespan_sys;
+			time_system("lifespan_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t) { reg.assign<lifespan_component>(id, { 1e9 }); },
+				[&](SDL& sdl) { lifespan_sys.update(sdl.reg, deltaTime); });
+
+			// One collider in ten is a bullet, the rest asteroids, as in collision_benchmark
+			collision_system collision_sys;
+			time_system("collision_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t i) { reg.assign<collision_component>(id, { i % 10 == 0 ? (std::uint32_t)layer_bullet : (std::uint32_t)layer_asteroid }); },
+				[&](SDL& sdl) { collision_sys.update(sdl.reg, deltaTime); });
+
+			// Spawners fire once a second with staggered timers, so a sixtieth of them spawn every update
+			asteroid_system asteroid_sys;
+			time_system("asteroid_system", mixes[mix], count, every[mix], frames,
+				[](registry& reg, entity id, std::size_t i) { reg.assign<asteroid_component>(id, { (i % 60 + 1) / 60.0, 1, i % 2 == 0 ? 1.0f : 0.0f, i % 2 == 0 ? 0.0f : 1.0f, 40, 40 }); },
+				[&](SDL& sdl) { asteroid_sys.update(sdl.reg, deltaTime, sdl); });
+		}
+	}
+
+	// Builds a population, times one system on it and keeps the result
+	// @param setup gives an entity the components of the system
+	// @param update runs the system once
+	template <typename Setup, typename Update>
+	void time_system(const char* name, const char* mix, std::size_t count, std::size_t every, int frames, Setup setup, Update update)
+	{
+		// The fixed seed builds the same population every repetition
+		SDL sdl;
+		sdl.textures.assign(3, NULL);
+		registry& reg = sdl.reg;
+		std::mt19937 random(1234);
+		float side = (float)std::sqrt((double)count) * 60;
+		std::uniform_real_distribution<float> position(0, side);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			entity id = reg.create();
+			reg.assign<sprite_component>(id, { {position(random), position(random), 40, 40}, NULL, 0 });
+			if (i % every == 0)
+			{
+				setup(reg, id, i);
+			}
+			else
+			{
+				reg.assign<controller_component>(id, { 0, 0 });
+			}
+		}
+
+		std::vector<double> times;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			double start = benchmark_clock();
+			update(sdl);
+			times.push_back(benchmark_clock() - start);
+			// Drop the recorded changes so every update sees the same population
+			reg.commands = command_buffer();
+		}
+		add_repetition(name, mix, count, frames, times);
+	}
+
+	// Times whole ticks of the stock game as a replay drives them, from the recording in assets/replays
+	// the input is read before each tick is timed, so only the simulation is measured
+	// @param path is the replay file, recorded with the stock lanes
+	void time_game(const char* path)
+	{
+		input_player player_input;
+		if (!player_input.open(path))
+		{
+			printf("Unable to read replay file %s, game_tick skipped\n", path);
+			return;
+		}
+		const replay_header& header = player_input.header;
+		if (header.scenario_hash != 0)
+		{
+			printf("Replay %s was recorded with scenario %s, game_tick skipped\n", path, header.scenario.c_str());
+			player_input.close();
+			return;
+		}
+
+		// Set the game up the way SDL::RunReplay does
+		SDL sdl;
+		sdl.reg.seed = header.seed;
+		sdl.timestep.tick_rate = header.tick_rate;
+		sdl.controls.defaults();
+		sdl.textures.assign(3, NULL);
+		game_systems systems;
+		systems.collision_sys.mode = (broad_phase)header.broad_phase;
+		sdl.CreateWorld();
+
+		double step = sdl.timestep.step();
+		std::vector<double> times;
+		tick_input input;
+		while (player_input.read(input))
+		{
+			sdl.controls.to_keys(input);
+			double start = benchmark_clock();
+			systems.apply(sdl, input);
+			systems.tick(sdl, step);
+			times.push_back(benchmark_clock() - start);
+		}
+		player_input.close();
+		if (!times.empty())
+		{
+			add_repetition("game_tick", "replay", sdl.reg.entities.size(), (int)times.size(), times);
+		}
+	}
+
+	// Keeps the median and the mean of one repetition of a benchmark
+	// @param times are the update times of every frame of the repetition
+	void add_repetition(const char* name, const char* mix, std::size_t count, int frames, std::vector<double>& times)
+	{
+		if (slot == results.size())
+		{
+			results.push_back({ name, mix, count, frames, 0, 0, 0, 0, 0, 0 });
+			medians.emplace_back();
+		}
+		double mean = 0;
+		for (double time : times)
+		{
+			mean += time / times.size();
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		medians[slot].push_back(times[times.size() / 2]);
+
+		// Average the means of the repetitions as they come
+		benchmark_result& result = results[slot];
+		result.mean_ms += (mean * 1e3 - result.mean_ms) / medians[slot].size();
+		++slot;
+	}
+};
+
+// benchmark_options are the command line options of --bench
+struct benchmark_options
+{
+	// name selects one benchmark, all of them run when it is empty
+	std::string name;
+	// json is the file the system benchmark results are written to, empty for none
+	std::string json;
+	// baseline is a results file to compare the system benchmarks against, empty for none
+	std::string baseline;
+	// threshold is the slowdown over the baseline counted as a regression, 0.1 for 10%
+	double threshold = 0.1;
+	// repetitions is the number of times every system benchmark runs, 0 picks 1, or 5 when writing or comparing results
+	int repetitions = 0;
+};
+
+// benchmark_names are the benchmarks --bench can select
+const char* const benchmark_names[] = { "view", "collision", "overlap", "lanes", "systems" };
+
+// benchmark_usage lists the options of --bench
+const char* const benchmark_usage = "[view|collision|overlap|lanes|systems] [--json file] [--baseline file] [--threshold pct] [--repeat n]";
+
+// Reads the options following --bench, returns false and prints why if one is unknown or its value is not valid
+// @param argc and args are the command line
+// @param first is the first argument to read
+// @param options receives the options
+inline bool read_benchmark_options(int argc, char* args[], int first, benchmark_options& options)
+{
+	for (int i = first; i < argc; ++i)
+	{
+		std::string option = args[i];
+		char* end = nullptr;
+		if (option == "--json" && i + 1 < argc)
+		{
+			options.json = args[++i];
+		}
+		else if (option == "--baseline" && i + 1 < argc)
+		{
+			options.baseline = args[++i];
+		}
+		else if (option == "--threshold" && i + 1 < argc)
+		{
+			double percent = strtod(args[++i], &end);
+			if (end == args[i] || *end != 0 || percent < 0)
+			{
+				printf("Invalid --threshold %s, expected a percentage of 0 or more\n", args[i]);
+				return false;
+			}
+			options.threshold = percent / 100;
+		}
+		else if (option == "--repeat" && i + 1 < argc)
+		{
+			long repetitions = strtol(args[++i], &end, 10);
+			if (end == args[i] || *end != 0 || repetitions < 1 || repetitions > 1000)
+			{
+				printf("Invalid --repeat %s, expected a count from 1 to 1000\n", args[i]);
+				return false;
+			}
+			options.repetitions = (int)repetitions;
+		}
+		else if (options.name.empty() && std::find(std::begin(benchmark_names), std::end(benchmark_names), option) != std::end(benchmark_names))
+		{
+			options.name = option;
+		}
+		else
+		{
+			printf("Unknown benchmark option %s\nUsage: --bench %s\n", option.c_str(), benchmark_usage);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Runs the benchmarks and prints the results, returns the exit code of the program
+// the code is 1 when a system benchmark regressed against the baseline, or the baseline cannot be read or is refused, or the results cannot be written
+// @param options selects the benchmarks and the reports
+inline int run_benchmarks(const benchmark_options& options)
+{
+	const std::string& name = options.name;
+	if (name.empty() || name == "view")
+	{
+		view_benchmark view_bench;
+		view_bench.run(1000, 1000);
+		view_bench.run(10000, 100);
+		view_bench.run(100000, 10);
+	}
+
+	if (name.empty() || name == "collision")
+	{
+		collision_benchmark collision_bench;
+		collision_bench.run(100, 1000);
+		collision_bench.run(1000, 100);
+		collision_bench.run(10000, 10);
+		collision_bench.run(100000, 5);
+	}
+
+	if (name.empty() || name == "overlap")
+	{
+		overlap_benchmark overlap_bench;
+		overlap_bench.run(1000, 20);
+		overlap_bench.run(10000, 1);
+	}
+
+	if (name.empty() || name == "lanes")
+	{
+		lane_benchmark lane_bench;
+		lane_bench.run(1, 60);
+		lane_bench.run(4, 30);
+		lane_bench.run(16, 10);
+	}
+
+	if (name.empty() || name == "systems")
+	{
+		system_benchmark system_bench;
+		system_bench.run_all(options.repetitions > 0 ? options.repetitions : options.json.empty() && options.baseline.empty() ? 1 : 5);
+		if (!options.json.empty() && !write_benchmark_json(options.json, system_bench.results))
+		{
+			printf("Unable to write benchmark results to %s\n", options.json.c_str());
+			return 1;
+		}
+
+		// Compare against the baseline and fail on a regression
+		if (!options.baseline.empty())
+		{
+			std::vector<benchmark_result> baseline;
+			if (!read_benchmark_json(options.baseline, baseline))
+			{
+				printf("Unable to read baseline %s\n", options.baseline.c_str());
+				return 1;
+			}
+			if (compare_benchmarks(baseline, system_bench.results, options.threshold) != 0)
+			{
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,834 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <SDL.h>
+#include "storage.cpp"
+#include "overlap.cpp"
+
+// broad_phase selects how collision_system finds the pairs of colliders to test
+enum broad_phase
+{
+	// broad_phase_all_pairs tests every pair of colliders
+	broad_phase_all_pairs,
+	// broad_phase_grid tests the pairs sharing a cell of a uniform grid
+	broad_phase_grid,
+	// broad_phase_sweep_and_prune tests the pairs overlapping on a persistently sorted axis
+	broad_phase_sweep_and_prune,
+	// broad_phase_aabb_tree tests the pairs found by querying a dynamic tree of fattened boxes
+	broad_phase_aabb_tree
+};
+
+// Reads a broad phase from its command line name
+// @param name is one of all, grid, sap or tree
+// @param mode receives the broad phase
+inline bool parse_broad_phase(const std::string& name, broad_phase& mode)
+{
+	if (name == "all")
+	{
+		mode = broad_phase_all_pairs;
+	}
+	else if (name == "grid")
+	{
+		mode = broad_phase_grid;
+	}
+	else if (name == "sap")
+	{
+		mode = broad_phase_sweep_and_prune;
+	}
+	else if (name == "tree")
+	{
+		mode = broad_phase_aabb_tree;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// collision_pair names two colliders by their position in the list given to the broad phase
+struct collision_pair
+{
+	std::uint32_t a;
+	std::uint32_t b;
+};
+
+// collision_filter is the collision layer of a collider and the layers it reacts to
+struct collision_filter
+{
+	std::uint32_t layer;
+	std::uint32_t mask;
+};
+
+// Returns true if two colliders react to each other, broad phases drop the pairs that do not
+// before testing their boxes, collision_matrix is symmetric so one side is enough
+inline bool interacts(const collision_filter& a, const collision_filter& b)
+{
+	return (a.mask & b.layer) != 0;
+}
+
+// uniform_grid is a broad phase that buckets boxes into square cells through a spatial hash
+// it is rebuilt every frame and reports each pair of boxes sharing a cell exactly once
+struct uniform_grid
+{
+	// cell_entry is one box registered in one of the cells it covers
+	struct cell_entry
+	{
+		std::int32_t cell_x;
+		std::int32_t cell_y;
+		std::uint32_t box;
+	};
+
+	// cell_size is the width and height of a cell, it should be close to the size of a typical box
+	float cell_size = 64;
+
+	// entries holds every (cell, box) registration of the frame
+	std::vector<cell_entry> entries;
+	// sorted holds the entries grouped by hash bucket
+	std::vector<cell_entry> sorted;
+	// bucket_start holds the offset of every hash bucket in sorted
+	std::vector<std::uint32_t> bucket_start;
+
+	// Finds the overlapping pairs among the boxes
+	// @param boxes is the list of boxes to test
+	// @param filters is the collision filter of each box
+	// @param pairs receives the overlapping pairs, it is cleared first
+	void find_pairs(const std::vector<aabb>& boxes, const std::vector<collision_filter>& filters, std::vector<collision_pair>& pairs)
+	{
+		pairs.clear();
+		entries.clear();
+		float inv = 1.0f / cell_size;
+		for (std::uint32_t i = 0; i < boxes.size(); ++i)
+		{
+			std::int32_t x0 = (std::int32_t)std::floor(boxes[i].min_x * inv);
+			std::int32_t y0 = (std::int32_t)std::floor(boxes[i].min_y * inv);
+			std::int32_t x1 = (std::int32_t)std::floor(boxes[i].max_x * inv);
+			std::int32_t y1 = (std::int32_t)std::floor(boxes[i].max_y * inv);
+			for (std::int32_t y = y0; y <= y1; ++y)
+			{
+				for (std::int32_t x = x0; x <= x1; ++x)
+				{
+					entries.push_back({ x, y, i });
+				}
+			}
+		}
+		if (entries.empty())
+		{
+			return;
+		}
+
+		// Counting sort the entries into a power of two number of buckets, about two per entry
+		std::uint32_t bucket_count = 1;
+		while (bucket_count < entries.size() * 2)
+		{
+			bucket_count <<= 1;
+		}
+		bucket_start.assign(bucket_count + 1, 0);
+		for (const cell_entry& entry : entries)
+		{
+			++bucket_start[hash(entry.cell_x, entry.cell_y, bucket_count) + 1];
+		}
+		for (std::uint32_t b = 0; b < bucket_count; ++b)
+		{
+			bucket_start[b + 1] += bucket_start[b];
+		}
+		sorted.resize(entries.size());
+		for (const cell_entry& entry : entries)
+		{
+			sorted[bucket_start[hash(entry.cell_x, entry.cell_y, bucket_count)]++] = entry;
+		}
+		// The placement loop advanced every start to the next bucket, shift them back
+		for (std::uint32_t b = bucket_count; b > 0; --b)
+		{
+			bucket_start[b] = bucket_start[b - 1];
+		}
+		bucket_start[0] = 0;
+
+		for (std::uint32_t b = 0; b < bucket_count; ++b)
+		{
+			for (std::uint32_t i = bucket_start[b]; i < bucket_start[b + 1]; ++i)
+			{
+				for (std::uint32_t j = i + 1; j < bucket_start[b + 1]; ++j)
+				{
+					const cell_entry& first = sorted[i];
+					const cell_entry& second = sorted[j];
+					// Different cells can share a bucket
+					if (first.cell_x != second.cell_x || first.cell_y != second.cell_y)
+					{
+						continue;
+					}
+					if (!interacts(filters[first.box], filters[second.box]))
+					{
+						continue;
+					}
+					// Report the pair only from the cell holding the corner of their overlap, so pairs
+					// sharing several cells are reported once
+					const aabb& a = boxes[first.box];
+					const aabb& c = boxes[second.box];
+					std::int32_t ref_x = (std::int32_t)std::floor(std::max(a.min_x, c.min_x) * inv);
+					std::int32_t ref_y = (std::int32_t)std::floor(std::max(a.min_y, c.min_y) * inv);
+					if (ref_x != first.cell_x || ref_y != first.cell_y)
+					{
+						continue;
+					}
+					if (!overlaps(a, c))
+					{
+						continue;
+					}
+					pairs.push_back({ first.box, second.box });
+				}
+			}
+		}
+	}
+
+	// Returns the bucket of a cell
+	static std::uint32_t hash(std::int32_t x, std::int32_t y, std::uint32_t bucket_count)
+	{
+		return (((std::uint32_t)x * 73856093u) ^ ((std::uint32_t)y * 19349663u)) & (bucket_count - 1);
+	}
+};
+
+// sweep_and_prune is a broad phase that keeps the colliders sorted by the left edge of their box
+// the order is kept between frames and repaired with an insertion sort, which is close to linear
+// when colliders move a little each frame, as the asteroid streams do
+// new colliders are sorted on their own and merged in, so a burst of spawns does not shift the whole list per collider
+struct sweep_and_prune
+{
+	// proxy is a collider in the sorted list, identified by its entity so it survives between frames
+	struct proxy
+	{
+		entity id;
+		std::uint32_t box;
+		aabb bounds;
+	};
+
+	// proxies holds the colliders sorted by bounds.min_x
+	std::vector<proxy> proxies;
+	// added holds the colliders new this frame and merged the list they are merged into, reused between frames
+	std::vector<proxy> added;
+	std::vector<proxy> merged;
+	// box_of maps an entity to its box for the current frame
+	sparse_set<std::uint32_t> box_of;
+	// tracked marks the boxes of the current frame that already have a proxy
+	std::vector<bool> tracked;
+	// sorted holds the bounds of the proxies in sorted order for the overlap kernel
+	aabb_soa sorted;
+	// hits receives the overlap kernel results
+	std::vector<std::uint32_t> hits;
+	// kernel is the instruction set used by the overlap kernel
+	overlap_kernel kernel = detect_overlap_kernel();
+
+	// Finds the overlapping pairs among the boxes
+	// @param ids is the entity of each box, used to follow colliders between frames
+	// @param boxes is the list of boxes to test
+	// @param filters is the collision filter of each box
+	// @param pairs receives the overlapping pairs, it is cleared first
+	void find_pairs(const std::vector<entity>& ids, const std::vector<aabb>& boxes, const std::vector<collision_filter>& filters, std::vector<collision_pair>& pairs)
+	{
+		pairs.clear();
+		box_of.clear();
+		for (std::uint32_t i = 0; i < ids.size(); ++i)
+		{
+			box_of.emplace(ids[i], i);
+		}
+
+		// Refresh the proxies that are still colliders and drop the others, keeping their order
+		tracked.assign(boxes.size(), false);
+		std::size_t kept = 0;
+		for (std::size_t i = 0; i < proxies.size(); ++i)
+		{
+			std::uint32_t* box = box_of.try_get(proxies[i].id);
+			if (box == nullptr)
+			{
+				continue;
+			}
+			proxies[kept].id = proxies[i].id;
+			proxies[kept].box = *box;
+			proxies[kept].bounds = boxes[*box];
+			tracked[*box] = true;
+			++kept;
+		}
+		proxies.resize(kept);
+
+		// Insertion sort, cheap because last frame's order is nearly right
+		for (std::size_t i = 1; i < proxies.size(); ++i)
+		{
+			proxy moving = proxies[i];
+			std::size_t j = i;
+			while (j > 0 && proxies[j - 1].bounds.min_x > moving.bounds.min_x)
+			{
+				proxies[j] = proxies[j - 1];
+				--j;
+			}
+			proxies[j] = moving;
+		}
+
+		// Sort the new colliders apart and merge them in, after the kept ones they tie with
+		added.clear();
+		for (std::uint32_t i = 0; i < boxes.size(); ++i)
+		{
+			if (!tracked[i])
+			{
+				added.push_back({ ids[i], i, boxes[i] });
+			}
+		}
+		if (!added.empty())
+		{
+			auto left_edge = [](const proxy& a, const proxy& b) { return a.bounds.min_x < b.bounds.min_x; };
+			std::stable_sort(added.begin(), added.end(), left_edge);
+			merged.clear();
+			std::merge(proxies.begin(), proxies.end(), added.begin(), added.end(), std::back_inserter(merged), left_edge);
+			proxies.swap(merged);
+		}
+
+		// Sweep along x, the run of boxes starting before a box ends is tested with the overlap kernel
+		sorted.clear();
+		for (const proxy& sorted_proxy : proxies)
+		{
+			sorted.push_back(sorted_proxy.bounds);
+		}
+		for (std::uint32_t i = 0; i < proxies.size(); ++i)
+		{
+			const aabb& a = proxies[i].bounds;
+			std::uint32_t end = (std::uint32_t)(std::lower_bound(sorted.min_x.begin() + i + 1, sorted.min_x.end(), a.max_x) - sorted.min_x.begin());
+			hits.clear();
+			overlap_range(kernel, a, sorted, i + 1, end, hits);
+			const collision_filter& filter = filters[proxies[i].box];
+			for (std::uint32_t j : hits)
+			{
+				if (interacts(filter, filters[proxies[j].box]))
+				{
+					pairs.push_back({ proxies[i].box, proxies[j].box });
+				}
+			}
+		}
+	}
+};
+
+// aabb_tree is a dynamic bounding volume tree over fattened boxes
+// leaves keep a box grown by a margin and by their recent motion, so a collider only has to be
+// reinserted when it leaves that box, and the tree is kept balanced with rotations as it changes
+// besides finding collision pairs it answers region and ray queries
+struct aabb_tree
+{
+	// null_node marks a missing node
+	enum { null_node = -1 };
+
+	// node is a leaf holding one collider or a branch holding the union of its two children
+	struct node
+	{
+		// box is the fattened box of a leaf or the union of the children of a branch
+		aabb box;
+		// tight is the box a leaf was last inserted with
+		aabb tight;
+		// id is the entity of a leaf
+		entity id;
+		// parent is the parent node, or the next free node while the node is unused
+		std::int32_t parent;
+		std::int32_t child1;
+		std::int32_t child2;
+		// height is 0 for leaves and -1 for free nodes
+		std::int32_t height;
+	};
+
+	// margin is how far a leaf box is grown on each side
+	float margin = 8;
+	// prediction is how many times its last displacement a leaf box is grown along the motion
+	float prediction = 2;
+
+	// nodes holds every node, unused ones are chained through parent
+	std::vector<node> nodes;
+	std::int32_t root = null_node;
+	std::int32_t free_list = null_node;
+	// leaf_count is the number of leaves in the tree
+	std::size_t leaf_count = 0;
+	// rotations counts the balancing rotations done since the last reset_metrics
+	std::size_t rotations = 0;
+	// reinserts counts the leaves that left their fattened box since the last reset_metrics
+	std::size_t reinserts = 0;
+	// stack is the traversal stack used by queries
+	std::vector<std::int32_t> stack;
+
+	// proxy_of maps an entity to its leaf, used by find_pairs
+	sparse_set<std::int32_t> proxy_of;
+	// box_of maps an entity to its box for the current frame, used by find_pairs
+	sparse_set<std::uint32_t> box_of;
+	// stale holds the entities that stopped colliding this frame
+	std::vector<entity> stale;
+
+	// Adds a leaf for an entity and returns its proxy
+	// @param id is the entity stored in the leaf
+	// @param box is the tight box of the entity
+	std::int32_t insert(entity id, const aabb& box)
+	{
+		std::int32_t leaf = allocate();
+		nodes[leaf].id = id;
+		nodes[leaf].tight = box;
+		nodes[leaf].box = fatten(box, 0, 0);
+		nodes[leaf].height = 0;
+		insert_leaf(leaf);
+		++leaf_count;
+		return leaf;
+	}
+
+	// Removes a leaf
+	// @param proxy is the leaf returned by insert
+	void remove(std::int32_t proxy)
+	{
+		remove_leaf(proxy);
+		release(proxy);
+		--leaf_count;
+	}
+
+	// Updates the box of a leaf, returns true if it left its fattened box and was reinserted
+	// @param proxy is the leaf returned by insert
+	// @param box is the new tight box of the entity
+	bool move(std::int32_t proxy, const aabb& box)
+	{
+		const aabb& fat = nodes[proxy].box;
+		if (fat.min_x <= box.min_x && fat.min_y <= box.min_y && box.max_x <= fat.max_x && box.max_y <= fat.max_y)
+		{
+			return false;
+		}
+		float dx = box.min_x - nodes[proxy].tight.min_x;
+		float dy = box.min_y - nodes[proxy].tight.min_y;
+		remove_leaf(proxy);
+		nodes[proxy].tight = box;
+		nodes[proxy].box = fatten(box, dx, dy);
+		insert_leaf(proxy);
+		++reinserts;
+		return true;
+	}
+
+	// Calls func(entity) for every leaf whose fattened box overlaps a region
+	// @param region is the box to search
+	// @param func is the callback receiving the entities
+	template <typename Func>
+	void query(const aabb& region, Func func)
+	{
+		if (root == null_node)
+		{
+			return;
+		}
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			std::int32_t index = stack.back();
+			stack.pop_back();
+			const node& current = nodes[index];
+			if (!(current.box.min_x < region.max_x && region.min_x < current.box.max_x && current.box.min_y < region.max_y && region.min_y < current.box.max_y))
+			{
+				continue;
+			}
+			if (current.height == 0)
+			{
+				func(current.id);
+				continue;
+			}
+			stack.push_back(current.child1);
+			stack.push_back(current.child2);
+		}
+	}
+
+	// Calls func(entity) for every leaf whose fattened box is crossed by the segment from (x0, y0) to (x1, y1)
+	// @param func is the callback receiving the entities, callers test the exact shape themselves
+	template <typename Func>
+	void raycast(float x0, float y0, float x1, float y1, Func func)
+	{
+		if (root == null_node)
+		{
+			return;
+		}
+		stack.clear();
+		stack.push_back(root);
+		while (!stack.empty())
+		{
+			std::int32_t index = stack.back();
+			stack.pop_back();
+			const node& current = nodes[index];
+			if (!segment_overlaps(current.box, x0, y0, x1, y1))
+			{
+				continue;
+			}
+			if (current.height == 0)
+			{
+				func(current.id);
+				continue;
+			}
+			stack.push_back(current.child1);
+			stack.push_back(current.child2);
+		}
+	}
+
+	// Brings the tree in line with this frame's colliders and finds the overlapping pairs among them
+	// @param ids is the entity of each box
+	// @param boxes is the list of boxes to test
+	// @param filters is the collision filter of each box
+	// @param pairs receives the overlapping pairs, it is cleared first
+	void find_pairs(const std::vector<entity>& ids, const std::vector<aabb>& boxes, const std::vector<collision_filter>& filters, std::vector<collision_pair>& pairs)
+	{
+		pairs.clear();
+		box_of.clear();
+		for (std::uint32_t i = 0; i < ids.size(); ++i)
+		{
+			box_of.emplace(ids[i], i);
+		}
+
+		// Remove the leaves of entities that are no longer colliders
+		stale.clear();
+		for (entity id : proxy_of.entities)
+		{
+			if (!box_of.contains(id))
+			{
+				stale.push_back(id);
+			}
+		}
+		for (entity id : stale)
+		{
+			remove(proxy_of.get(id));
+			proxy_of.erase(id);
+		}
+
+		// Insert the new colliders and move the others
+		for (std::uint32_t i = 0; i < ids.size(); ++i)
+		{
+			std::int32_t* proxy = proxy_of.try_get(ids[i]);
+			if (proxy == nullptr)
+			{
+				proxy_of.emplace(ids[i], insert(ids[i], boxes[i]));
+			}
+			else
+			{
+				move(*proxy, boxes[i]);
+			}
+		}
+
+		// Query every box and keep each pair from the side with the lower index
+		// the leaves are fattened, so the tight boxes are checked before a pair is reported
+		for (std::uint32_t i = 0; i < boxes.size(); ++i)
+		{
+			if (filters[i].mask == 0)
+			{
+				continue;
+			}
+			const aabb& a = boxes[i];
+			query(a, [&](entity other)
+			{
+				std::uint32_t j = box_of.get(other);
+				const aabb& b = boxes[j];
+				if (j > i && interacts(filters[i], filters[j]) && overlaps(a, b))
+				{
+					pairs.push_back({ i, j });
+				}
+			});
+		}
+	}
+
+	// Returns the height of the tree
+	std::int32_t height() const
+	{
+		return root == null_node ? 0 : nodes[root].height;
+	}
+
+	// Returns the summed perimeter of all branches divided by the perimeter of the root, lower is tighter
+	float area_ratio() const
+	{
+		if (root == null_node)
+		{
+			return 0;
+		}
+		float total = 0;
+		for (const node& current : nodes)
+		{
+			if (current.height > 0)
+			{
+				total += perimeter(current.box);
+			}
+		}
+		float root_perimeter = perimeter(nodes[root].box);
+		return root_perimeter > 0 ? total / root_perimeter : 0;
+	}
+
+	// Returns the largest height difference between the two children of any branch
+	std::int32_t max_balance() const
+	{
+		std::int32_t balance = 0;
+		for (const node& current : nodes)
+		{
+			if (current.height > 1)
+			{
+				balance = std::max(balance, std::abs(nodes[current.child2].height - nodes[current.child1].height));
+			}
+		}
+		return balance;
+	}
+
+	// Resets the rotation and reinsert counters
+	void reset_metrics()
+	{
+		rotations = 0;
+		reinserts = 0;
+	}
+
+	// Returns the fattened box of a leaf
+	aabb fatten(const aabb& box, float dx, float dy) const
+	{
+		aabb fat = { box.min_x - margin, box.min_y - margin, box.max_x + margin, box.max_y + margin };
+		if (dx < 0) fat.min_x += dx * prediction; else fat.max_x += dx * prediction;
+		if (dy < 0) fat.min_y += dy * prediction; else fat.max_y += dy * prediction;
+		return fat;
+	}
+
+	// Returns the perimeter of a box, the cost used to choose where leaves go
+	static float perimeter(const aabb& box)
+	{
+		return 2 * ((box.max_x - box.min_x) + (box.max_y - box.min_y));
+	}
+
+	// Returns true if the segment from (x0, y0) to (x1, y1) crosses a box
+	static bool segment_overlaps(const aabb& box, float x0, float y0, float x1, float y1)
+	{
+		float enter = 0;
+		float leave = 1;
+		float start[2] = { x0, y0 };
+		float delta[2] = { x1 - x0, y1 - y0 };
+		float low[2] = { box.min_x, box.min_y };
+		float high[2] = { box.max_x, box.max_y };
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			if (delta[axis] == 0)
+			{
+				if (start[axis] < low[axis] || start[axis] > high[axis])
+				{
+					return false;
+				}
+				continue;
+			}
+			float t0 = (low[axis] - start[axis]) / delta[axis];
+			float t1 = (high[axis] - start[axis]) / delta[axis];
+			enter = std::max(enter, std::min(t0, t1));
+			leave = std::min(leave, std::max(t0, t1));
+			if (enter > leave)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Takes a node from the free list or grows the node array
+	std::int32_t allocate()
+	{
+		if (free_list == null_node)
+		{
+			node fresh = {};
+			fresh.parent = null_node;
+			fresh.height = -1;
+			nodes.push_back(fresh);
+			free_list = (std::int32_t)nodes.size() - 1;
+		}
+		std::int32_t index = free_list;
+		free_list = nodes[index].parent;
+		nodes[index].parent = null_node;
+		nodes[index].child1 = null_node;
+		nodes[index].child2 = null_node;
+		nodes[index].height = 0;
+		return index;
+	}
+
+	// Returns a node to the free list
+	void release(std::int32_t index)
+	{
+		nodes[index].parent = free_list;
+		nodes[index].height = -1;
+		free_list = index;
+	}
+
+	// Links a leaf into the tree next to the sibling that grows the tree the least
+	void insert_leaf(std::int32_t leaf)
+	{
+		if (root == null_node)
+		{
+			root = leaf;
+			nodes[root].parent = null_node;
+			return;
+		}
+
+		aabb box = nodes[leaf].box;
+		std::int32_t index = root;
+		while (nodes[index].height > 0)
+		{
+			std::int32_t child1 = nodes[index].child1;
+			std::int32_t child2 = nodes[index].child2;
+			float area = perimeter(nodes[index].box);
+			float combined_area = perimeter(combine(nodes[index].box, box));
+
+			// Cost of making a new parent for this node and the leaf
+			float cost = 2 * combined_area;
+			// Minimum cost of pushing the leaf further down
+			float inheritance = 2 * (combined_area - area);
+
+			float cost1 = descend_cost(child1, box) + inheritance;
+			float cost2 = descend_cost(child2, box) + inheritance;
+			if (cost < cost1 && cost < cost2)
+			{
+				break;
+			}
+			index = cost1 < cost2 ? child1 : child2;
+		}
+
+		std::int32_t sibling = index;
+		std::int32_t old_parent = nodes[sibling].parent;
+		std::int32_t new_parent = allocate();
+		nodes[new_parent].parent = old_parent;
+		nodes[new_parent].box = combine(box, nodes[sibling].box);
+		nodes[new_parent].height = nodes[sibling].height + 1;
+		nodes[new_parent].child1 = sibling;
+		nodes[new_parent].child2 = leaf;
+		nodes[sibling].parent = new_parent;
+		nodes[leaf].parent = new_parent;
+		if (old_parent == null_node)
+		{
+			root = new_parent;
+		}
+		else if (nodes[old_parent].child1 == sibling)
+		{
+			nodes[old_parent].child1 = new_parent;
+		}
+		else
+		{
+			nodes[old_parent].child2 = new_parent;
+		}
+		refit(nodes[leaf].parent);
+	}
+
+	// Returns the cost of descending into a child to place a box
+	float descend_cost(std::int32_t child, const aabb& box) const
+	{
+		float combined = perimeter(combine(box, nodes[child].box));
+		if (nodes[child].height == 0)
+		{
+			return combined;
+		}
+		return combined - perimeter(nodes[child].box);
+	}
+
+	// Unlinks a leaf from the tree, its parent is replaced by its sibling
+	void remove_leaf(std::int32_t leaf)
+	{
+		if (leaf == root)
+		{
+			root = null_node;
+			return;
+		}
+		std::int32_t parent = nodes[leaf].parent;
+		std::int32_t grand_parent = nodes[parent].parent;
+		std::int32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+		if (grand_parent == null_node)
+		{
+			root = sibling;
+			nodes[sibling].parent = null_node;
+			release(parent);
+			return;
+		}
+		if (nodes[grand_parent].child1 == parent)
+		{
+			nodes[grand_parent].child1 = sibling;
+		}
+		else
+		{
+			nodes[grand_parent].child2 = sibling;
+		}
+		nodes[sibling].parent = grand_parent;
+		release(parent);
+		refit(grand_parent);
+	}
+
+	// Walks from a branch to the root, balancing and refitting every branch on the way
+	void refit(std::int32_t index)
+	{
+		while (index != null_node)
+		{
+			index = balance(index);
+			std::int32_t child1 = nodes[index].child1;
+			std::int32_t child2 = nodes[index].child2;
+			nodes[index].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+			nodes[index].box = combine(nodes[child1].box, nodes[child2].box);
+			index = nodes[index].parent;
+		}
+	}
+
+	// Rotates the taller grandchild of a branch above it if the branch is unbalanced
+	// returns the branch now at the position of a
+	std::int32_t balance(std::int32_t a)
+	{
+		if (nodes[a].height < 2)
+		{
+			return a;
+		}
+		std::int32_t b = nodes[a].child1;
+		std::int32_t c = nodes[a].child2;
+		std::int32_t difference = nodes[c].height - nodes[b].height;
+		if (difference > 1)
+		{
+			rotate(a, c, b, true);
+			return c;
+		}
+		if (difference < -1)
+		{
+			rotate(a, b, c, false);
+			return b;
+		}
+		return a;
+	}
+
+	// Lifts the tall child of a above a, a keeps the short child and the lower of the tall child's children
+	// @param tall_is_child2 tells which slot of a the tall child came from
+	void rotate(std::int32_t a, std::int32_t tall, std::int32_t short_child, bool tall_is_child2)
+	{
+		std::int32_t f = nodes[tall].child1;
+		std::int32_t g = nodes[tall].child2;
+
+		// Swap a and its tall child
+		nodes[tall].child1 = a;
+		nodes[tall].parent = nodes[a].parent;
+		nodes[a].parent = tall;
+		if (nodes[tall].parent == null_node)
+		{
+			root = tall;
+		}
+		else if (nodes[nodes[tall].parent].child1 == a)
+		{
+			nodes[nodes[tall].parent].child1 = tall;
+		}
+		else
+		{
+			nodes[nodes[tall].parent].child2 = tall;
+		}
+
+		// Keep the taller grandchild under the lifted node and give the other one to a
+		std::int32_t keep = nodes[f].height > nodes[g].height ? f : g;
+		std::int32_t give = keep == f ? g : f;
+		nodes[tall].child2 = keep;
+		if (tall_is_child2)
+		{
+			nodes[a].child2 = give;
+		}
+		else
+		{
+			nodes[a].child1 = give;
+		}
+		nodes[give].parent = a;
+		nodes[a].box = combine(nodes[short_child].box, nodes[give].box);
+		nodes[tall].box = combine(nodes[a].box, nodes[keep].box);
+		nodes[a].height = 1 + std::max(nodes[short_child].height, nodes[give].height);
+		nodes[tall].height = 1 + std::max(nodes[a].height, nodes[keep].height);
+		++rotations;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <tuple>
+#include <utility>
+#include "components.cpp"
+
+// pending_change is one recorded addition or removal of a component
+template <typename T>
+struct pending_change
+{
+	// id is the entity changed
+	entity id;
+	// assigned is true for an addition and false for a removal
+	bool assigned;
+	// value is the component data of an addition
+	T value;
+};
+
+// pending_changes holds the recorded additions and removals of one component type
+template <typename T>
+struct pending_changes
+{
+	// changes holds the additions and removals in the order they were recorded
+	std::vector<pending_change<T>> changes;
+};
+
+// basic_command_buffer records structural changes made while systems iterate the pools
+// nothing is applied until the registry flushes the buffer at a sync point of the game loop
+template <typename... Ts>
+struct basic_command_buffer
+{
+	// queues holds the pending changes of every component type
+	std::tuple<pending_changes<Ts>...> queues;
+	// destroyed holds the entities to destroy
+	std::vector<entity> destroyed;
+
+	// Returns the pending changes of component type T
+	template <typename T>
+	pending_changes<T>& queue()
+	{
+		return std::get<pending_changes<T>>(queues);
+	}
+
+	// Records a component to add to an entity, the last change recorded for an entity wins
+	// @param id is the entity receiving the component
+	// @param value is the component data
+	template <typename T>
+	void assign(entity id, const T& value)
+	{
+		queue<T>().changes.push_back({ id, true, value });
+	}
+
+	// Records a component to remove from an entity, the last change recorded for an entity wins
+	// @param id is the entity losing the component
+	template <typename T>
+	void remove(entity id)
+	{
+		queue<T>().changes.push_back({ id, false, T() });
+	}
+
+	// Records an entity to destroy
+	// @param id is the entity to destroy
+	void destroy(entity id)
+	{
+		destroyed.push_back(id);
+	}
+};
+
+// command_buffer records structural changes for every component type of the registry
+using command_buffer = basic_command_buffer<sprite_component, movement_component, controller_component, velocity_component, rotation_component, tracking_component, lifespan_component, collision_component, asteroid_component>;
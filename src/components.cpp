@@ -2,8 +2,8 @@
 #include <vector>
 #include <SDL.h>
 #include <string>
-
-using entity = std::size_t;
+#include "entities.cpp"
+#include "random.cpp"
 
 // sprite_component represents the visual aspect of an entity
 struct sprite_component
@@ -72,11 +72,85 @@ struct lifespan_component
     double lifespan;
 };
 
-// collision_component represents the collision tag of an entity
+// collision_layer is the bit of one collision layer
+enum collision_layer
+{
+    layer_asteroid = 1 << 0,
+    layer_player = 1 << 1,
+    layer_bullet = 1 << 2
+};
+
+// layer_count is the number of collision layers
+const int layer_count = 3;
+
+// collision_response tells which entities of a colliding pair are destroyed
+enum collision_response
+{
+    response_none = 0,
+    response_destroy_first = 1 << 0,
+    response_destroy_second = 1 << 1,
+    response_destroy_both = response_destroy_first | response_destroy_second
+};
+
+// collision_matrix holds the response to every pair of layers, the row is the layer of the first entity
+// and the column the layer of the second, both indexed by the position of the layer bit
+constexpr collision_response collision_matrix[layer_count][layer_count] =
+{
+    //                 asteroid                player                   bullet
+    /* asteroid */   { response_none,          response_destroy_second, response_destroy_both },
+    /* player */     { response_destroy_first, response_none,           response_none },
+    /* bullet */     { response_destroy_both,  response_none,           response_none }
+};
+
+// Returns the position of a layer bit, used to index collision_matrix
+// @param layer is a collision_layer bit
+constexpr int layer_index(std::uint32_t layer)
+{
+    return layer <= 1 ? 0 : 1 + layer_index(layer >> 1);
+}
+
+// Returns true if swapping the two entities of a pair swaps the response, so a pair can be resolved from one side
+constexpr bool collision_matrix_symmetric()
+{
+    for (int i = 0; i < layer_count; ++i)
+    {
+        for (int j = 0; j < layer_count; ++j)
+        {
+            int swapped = ((collision_matrix[j][i] & response_destroy_first) << 1) | ((collision_matrix[j][i] & response_destroy_second) >> 1);
+            if (collision_matrix[i][j] != swapped)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(collision_matrix_symmetric(), "collision_matrix must give the same response from both sides of a pair");
+
+// Returns the layers that a layer reacts to
+// @param layer is a collision_layer bit
+inline std::uint32_t collision_mask(std::uint32_t layer)
+{
+    std::uint32_t mask = 0;
+    for (int other = 0; other < layer_count; ++other)
+    {
+        if (collision_matrix[layer_index(layer)][other] != response_none)
+        {
+            mask |= 1u << other;
+        }
+    }
+    return mask;
+}
+
+// collision_component represents the collision layer of an entity
 struct collision_component
 {
-    // tag is the collision tag of the entity
-    char tag;
+    // layer is the collision_layer bit of the entity
+    std::uint32_t layer;
+    // continuous marks a fast mover, it is tested along the path it moved since the last collision update
+    // so it cannot pass through thin colliders between two frames
+    bool continuous = false;
 };
 
 // asteroid_component represents the spawning properties of asteroids
@@ -94,4 +168,10 @@ struct asteroid_component
     float width;
     // height is the height of the asteroid
     float height;
+    // random is the spawner's own random stream, seeded from the world seed on its first spawn
+    pcg32 random = pcg32();
+    // speed is the speed of the spawned asteroids
+    float speed = 200;
+    // lifespan is the time the spawned asteroids live, in seconds
+    double lifespan = 5;
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// Define an entity as a 64 bit handle
+// the low 32 bits are the index used by the component pools and the high 32 bits are the generation of that index
+using entity = std::uint64_t;
+
+// Returns the pool index of an entity
+// @param id is the entity handle
+inline std::uint32_t entity_index(entity id)
+{
+	return (std::uint32_t)id;
+}
+
+// Returns the generation of an entity
+// @param id is the entity handle
+inline std::uint32_t entity_generation(entity id)
+{
+	return (std::uint32_t)(id >> 32);
+}
+
+// Combines an index and a generation into an entity handle
+// @param index is the pool index
+// @param generation is the generation of the index
+inline entity make_entity(std::uint32_t index, std::uint32_t generation)
+{
+	return ((entity)generation << 32) | index;
+}
+
+// entity_manager hands out entity handles and recycles the indices of destroyed entities
+// destroying an entity bumps the generation of its index, so old handles to it stop matching
+struct entity_manager
+{
+	// generations holds the current generation of every index, index 0 is reserved for the null entity
+	std::vector<std::uint32_t> generations = std::vector<std::uint32_t>(1, 0);
+	// free_indices holds the indices of destroyed entities waiting to be reused
+	std::vector<std::uint32_t> free_indices;
+
+	// Returns a new entity, reusing the most recently freed index when there is one
+	entity create()
+	{
+		if (!free_indices.empty())
+		{
+			std::uint32_t index = free_indices.back();
+			free_indices.pop_back();
+			return make_entity(index, generations[index]);
+		}
+		generations.push_back(0);
+		return make_entity((std::uint32_t)(generations.size() - 1), 0);
+	}
+
+	// Returns true if the handle refers to an entity that has not been destroyed
+	// @param id is the entity handle
+	bool alive(entity id) const
+	{
+		std::uint32_t index = entity_index(id);
+		return index != 0 && index < generations.size() && generations[index] == entity_generation(id);
+	}
+
+	// Frees the index of an entity so it can be reused by a later create
+	// @param id is the entity handle
+	void destroy(entity id)
+	{
+		if (!alive(id))
+		{
+			return;
+		}
+		std::uint32_t index = entity_index(id);
+		++generations[index];
+		free_indices.push_back(index);
+	}
+
+	// Returns the number of entities that are alive
+	std::size_t size() const
+	{
+		return generations.size() - 1 - free_indices.size();
+	}
+};
@@ -0,0 +1,287 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <SDL.h>
+#include "SDL.h"
+#include "profiler.cpp"
+
+// hud_glyph_chars are the characters of the embedded font, lower case letters are drawn as upper case
+const char hud_glyph_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ.:-_/=%()";
+
+// hud_glyphs are the 3 by 5 pixel glyphs of hud_glyph_chars, three bits per row from the top, the highest bit on the left
+const std::uint16_t hud_glyphs[] = {
+	0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249, 0x7bef, 0x7bcf,
+	0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79e7, 0x79e4, 0x396b, 0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed,
+	0x6b6d, 0x2b6a, 0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd, 0x5aad, 0x5a92, 0x72a7,
+	0x0002, 0x0410, 0x01c0, 0x0007, 0x12a4, 0x0e38, 0x52a5, 0x2922, 0x224a
+};
+
+// hud_overlay draws frame and simulation statistics over the game, toggled with F3
+// the whole overlay is built as coloured triangles and drawn with one SDL_RenderGeometry call, no textures are involved
+struct hud_overlay
+{
+	// scale is the size of a font pixel on screen
+	static const int scale = 2;
+	// history is the number of frame times in the graph
+	static const int history = 120;
+
+	// visible is true while the overlay is drawn
+	bool visible = false;
+	// glyphs maps every ASCII character to its glyph, 0 for characters the font lacks
+	std::uint16_t glyphs[128] = {};
+	// frame_times holds the last frame times in seconds as a ring buffer, next is the oldest
+	double frame_times[history] = {};
+	int next = 0;
+	// target is the frame time the graph marks, in seconds
+	double target = 1.0 / 60;
+
+	// scope is the smoothed time per frame spent in a profiled scope
+	struct scope
+	{
+		const char* name;
+		double seconds;
+		double frame;
+	};
+	std::vector<scope> scopes;
+	// cursors are the counts of the profile buffers up to which their events were read, by thread number
+	std::vector<std::uint64_t> cursors;
+	// built is the time the last build took, cost is the smoothed time of building and drawing the overlay, in seconds
+	double built = 0;
+	double cost = 0;
+
+	// vertices and indices are the triangles of the overlay, rebuilt every frame
+	std::vector<SDL_Vertex> vertices;
+	std::vector<int> indices;
+
+	hud_overlay()
+	{
+		for (int i = 0; hud_glyph_chars[i] != 0; ++i)
+		{
+			glyphs[(int)hud_glyph_chars[i]] = hud_glyphs[i];
+		}
+	}
+
+	// Shows or hides the overlay
+	void toggle()
+	{
+		visible = !visible;
+	}
+
+	// Adds the time of a frame to the graph, called every frame so the graph is full when the overlay is shown
+	// @param seconds is the real time of the frame
+	void frame(double seconds)
+	{
+		frame_times[next] = seconds;
+		next = (next + 1) % history;
+	}
+
+	// Builds the triangles of the overlay, nothing when it is hidden
+	// @param reg is the registry whose pools are counted
+	// @param pairs_tested is the number of pairs the collision system tested in its last update
+	void build(const registry& reg, std::size_t pairs_tested)
+	{
+		vertices.clear();
+		indices.clear();
+		Uint64 start = SDL_GetPerformanceCounter();
+		read_profile();
+		if (!visible)
+		{
+			return;
+		}
+		const float line = 7 * scale;
+		const float left = 8;
+		float y = 8;
+		char text[128];
+		// right is the right edge of the widest line so far, the graph included
+		float right = left + history * 2.0f;
+
+		// Panel behind the text, sized at the end once the last line is known
+		std::size_t panel = vertices.size();
+		quad(0, 0, 0, 0, { 0, 0, 0, 160 });
+
+		// Frame rate and frame times
+		double sum = 0;
+		double worst = 0;
+		for (double seconds : frame_times)
+		{
+			sum += seconds;
+			worst = std::max(worst, seconds);
+		}
+		double last = frame_times[(next + history - 1) % history];
+		snprintf(text, sizeof(text), "FPS %.1f  FRAME %.2f MS  WORST %.2f MS", sum > 0 ? history / sum : 0.0, last * 1e3, worst * 1e3);
+		right = std::max(right, print(left, y, text, { 255, 255, 255, 255 }));
+		y += line;
+
+		// Frame time graph, one bar per frame, red above the target, with a line at the target
+		const float graph_height = 60;
+		const float ms_height = graph_height / (float)(target * 2e3);
+		y += 2;
+		for (int i = 0; i < history; ++i)
+		{
+			double seconds = frame_times[(next + i) % history];
+			float height = std::min(graph_height, (float)(seconds * 1e3) * ms_height);
+			SDL_Color color = seconds > target * 1.05 ? SDL_Color{ 230, 60, 60, 255 } : SDL_Color{ 60, 200, 90, 255 };
+			quad(left + i * 2.0f, y + graph_height - height, 2, height, color);
+		}
+		quad(left, y + graph_height - (float)(target * 1e3) * ms_height, history * 2.0f, 1, { 255, 255, 255, 128 });
+		y += graph_height + 4;
+
+		// Entities and the size of every component pool
+		snprintf(text, sizeof(text), "ENTITIES %zu  PAIRS TESTED %zu", reg.entities.size(), pairs_tested);
+		right = std::max(right, print(left, y, text, { 255, 255, 255, 255 }));
+		y += line;
+		snprintf(text, sizeof(text), "SPRITE %zu MOVE %zu CTRL %zu VEL %zu ROT %zu", reg.sprites.size(), reg.movements.size(), reg.controllers.size(), reg.velocities.size(), reg.rotations.size());
+		right = std::max(right, print(left, y, text, { 200, 200, 200, 255 }));
+		y += line;
+		snprintf(text, sizeof(text), "TRACK %zu LIFE %zu COLL %zu AST %zu", reg.trackers.size(), reg.lifespans.size(), reg.collisions.size(), reg.asteroids.size());
+		right = std::max(right, print(left, y, text, { 200, 200, 200, 255 }));
+		y += line;
+
+		// Time per frame of every profiled scope
+		for (const scope& s : scopes)
+		{
+			snprintf(text, sizeof(text), "%-18s %7.3f MS", s.name, s.seconds * 1e3);
+			right = std::max(right, print(left, y, text, { 255, 220, 120, 255 }));
+			y += line;
+		}
+		snprintf(text, sizeof(text), "%-18s %7.3f MS", "hud", cost * 1e3);
+		right = std::max(right, print(left, y, text, { 120, 200, 255, 255 }));
+		y += line;
+
+		// Size the panel to the widest line
+		set_quad(panel, 0, 0, right + left, y + 4);
+		built = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	}
+
+	// Draws the triangles built by build with one call
+	// @param renderer is the renderer to draw with
+	void draw(SDL_Renderer* renderer)
+	{
+		if (vertices.empty())
+		{
+			return;
+		}
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_BlendMode mode;
+		SDL_GetRenderDrawBlendMode(renderer, &mode);
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+		SDL_RenderGeometry(renderer, NULL, vertices.data(), (int)vertices.size(), indices.data(), (int)indices.size());
+		SDL_SetRenderDrawBlendMode(renderer, mode);
+		double drawn = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		cost += (built + drawn - cost) * 0.05;
+	}
+
+	// Adds the scopes recorded on every thread since the last frame to their smoothed times
+	// called between ticks, while the pool workers are idle, so the events read are not being overwritten
+	// while hidden it only skips them, so showing the overlay does not read a backlog
+	void read_profile()
+	{
+#ifndef PROFILER_DISABLED
+		profiler& profile = global_profiler();
+		std::lock_guard<std::mutex> guard(profile.lock);
+		cursors.resize(profile.buffers.size(), 0);
+		if (!visible)
+		{
+			for (auto& buffer : profile.buffers)
+			{
+				cursors[buffer->thread] = buffer->recorded();
+			}
+			return;
+		}
+		double frequency = (double)SDL_GetPerformanceFrequency();
+		for (scope& s : scopes)
+		{
+			s.frame = 0;
+		}
+		for (auto& buffer : profile.buffers)
+		{
+			buffer->since(cursors[buffer->thread], [&](const profile_event& event)
+			{
+				scope* found = nullptr;
+				for (scope& s : scopes)
+				{
+					if (s.name == event.name || strcmp(s.name, event.name) == 0)
+					{
+						found = &s;
+						break;
+					}
+				}
+				if (found == nullptr)
+				{
+					scopes.push_back({ event.name, 0, 0 });
+					found = &scopes.back();
+				}
+				found->frame += (event.end - event.start) / frequency;
+			});
+		}
+		for (scope& s : scopes)
+		{
+			s.seconds += (s.frame - s.seconds) * 0.05;
+		}
+#endif
+	}
+
+	// Adds a filled rectangle
+	void quad(float x, float y, float w, float h, SDL_Color color)
+	{
+		int first = (int)vertices.size();
+		vertices.resize(vertices.size() + 4);
+		set_quad(first, x, y, w, h);
+		for (int i = 0; i < 4; ++i)
+		{
+			vertices[first + i].color = color;
+			vertices[first + i].tex_coord = { 0, 0 };
+		}
+		int order[6] = { 0, 1, 2, 2, 1, 3 };
+		for (int i : order)
+		{
+			indices.push_back(first + i);
+		}
+	}
+
+	// Moves the rectangle whose first vertex is first
+	void set_quad(std::size_t first, float x, float y, float w, float h)
+	{
+		vertices[first].position = { x, y };
+		vertices[first + 1].position = { x + w, y };
+		vertices[first + 2].position = { x, y + h };
+		vertices[first + 3].position = { x + w, y + h };
+	}
+
+	// Adds a line of text, each run of lit pixels in a glyph row becomes one rectangle
+	// returns the right edge of the last glyph
+	float print(float x, float y, const char* text, SDL_Color color)
+	{
+		for (; *text != 0; ++text, x += 4 * scale)
+		{
+			int c = *text;
+			if (c >= 'a' && c <= 'z')
+			{
+				c -= 'a' - 'A';
+			}
+			std::uint16_t glyph = c > 0 && c < 128 ? glyphs[c] : 0;
+			for (int row = 0; row < 5 && glyph != 0; ++row)
+			{
+				int bits = (glyph >> (12 - row * 3)) & 7;
+				int column = 0;
+				while (column < 3)
+				{
+					if (!(bits & (4 >> column)))
+					{
+						++column;
+						continue;
+					}
+					int run = column;
+					while (run < 3 && (bits & (4 >> run)))
+					{
+						++run;
+					}
+					quad(x + column * scale, y + row * scale, (float)(run - column) * scale, (float)scale, color);
+					column = run;
+				}
+			}
+		}
+		return x - scale;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,299 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <SDL.h>
+#include "replay.cpp"
+
+// input_action is something the player can ask the game to do, each action owns one bit of the action masks
+enum input_action
+{
+	action_up,
+	action_down,
+	action_left,
+	action_right,
+	action_fire,
+	action_toggle_mode,
+	action_count
+};
+
+// Returns the bit of an action in the action masks
+// @param action is the action
+inline std::uint32_t action_bit(int action)
+{
+	return 1u << action;
+}
+
+// action_names are the names of the actions in the controls file
+const char* const action_names[action_count] = { "up", "down", "left", "right", "fire", "toggle_mode" };
+
+// Returns the action with a name, or action_count if there is none
+// @param name is the name from the controls file
+inline int parse_action(const std::string& name)
+{
+	for (int action = 0; action < action_count; ++action)
+	{
+		if (name == action_names[action])
+		{
+			return action;
+		}
+	}
+	return action_count;
+}
+
+// Returns a piece of text without the spaces around it
+inline std::string trim(const std::string& text)
+{
+	std::size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos)
+	{
+		return "";
+	}
+	return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+// action_map binds keys to actions with one lookup table indexed by scancode
+// an action can have any number of keys, a key triggers at most one action
+struct action_map
+{
+	// actions holds the action of every scancode, action_count where the key is not bound
+	std::uint8_t actions[SDL_NUM_SCANCODES];
+
+	action_map()
+	{
+		defaults();
+	}
+
+	// Removes every binding
+	void clear()
+	{
+		std::fill(actions, actions + SDL_NUM_SCANCODES, (std::uint8_t)action_count);
+	}
+
+	// Restores the built-in bindings, WASD and the arrows to move, space to fire and left shift to switch movement
+	void defaults()
+	{
+		clear();
+		bind(SDL_SCANCODE_W, action_up);
+		bind(SDL_SCANCODE_UP, action_up);
+		bind(SDL_SCANCODE_S, action_down);
+		bind(SDL_SCANCODE_DOWN, action_down);
+		bind(SDL_SCANCODE_A, action_left);
+		bind(SDL_SCANCODE_LEFT, action_left);
+		bind(SDL_SCANCODE_D, action_right);
+		bind(SDL_SCANCODE_RIGHT, action_right);
+		bind(SDL_SCANCODE_SPACE, action_fire);
+		bind(SDL_SCANCODE_LSHIFT, action_toggle_mode);
+	}
+
+	// Binds a key to an action, replacing the action it had
+	// @param scancode is the key
+	// @param action is the action, action_count unbinds the key
+	void bind(std::int32_t scancode, int action)
+	{
+		if (scancode > SDL_SCANCODE_UNKNOWN && scancode < SDL_NUM_SCANCODES)
+		{
+			actions[scancode] = (std::uint8_t)action;
+		}
+	}
+
+	// Returns the first key bound to an action, SDL_SCANCODE_UNKNOWN if it has none
+	std::int32_t key_of(int action) const
+	{
+		for (std::int32_t scancode = 0; scancode < SDL_NUM_SCANCODES; ++scancode)
+		{
+			if (actions[scancode] == action)
+			{
+				return scancode;
+			}
+		}
+		return SDL_SCANCODE_UNKNOWN;
+	}
+
+	// Removes every key of an action
+	void unbind(int action)
+	{
+		std::replace(actions, actions + SDL_NUM_SCANCODES, (std::uint8_t)action, (std::uint8_t)action_count);
+	}
+
+	// Returns the action of a key, or action_count if it is not bound
+	// @param scancode is the key
+	int action(std::int32_t scancode) const
+	{
+		if (scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_NUM_SCANCODES)
+		{
+			return action_count;
+		}
+		return actions[scancode];
+	}
+
+	// Replaces the key of every event with its action and drops the events of unbound keys, the form replays record
+	// @param input is the input of a tick
+	void to_actions(tick_input& input) const
+	{
+		std::size_t kept = 0;
+		for (const input_event& event : input.events)
+		{
+			int bound = action(event.key);
+			if (bound != action_count)
+			{
+				input.events[kept] = event;
+				input.events[kept++].key = bound;
+			}
+		}
+		input.events.resize(kept);
+	}
+
+	// Replaces the action of every event with a key bound to it, undoing to_actions
+	// @param input is the input of a tick read from a replay
+	void to_keys(tick_input& input) const
+	{
+		for (input_event& event : input.events)
+		{
+			event.key = event.key >= 0 && event.key < action_count ? key_of(event.key) : SDL_SCANCODE_UNKNOWN;
+		}
+	}
+
+	// Reads the bindings from a controls file, returns false if it cannot be opened
+	// every line binds an action to a comma separated list of SDL key names, like "fire = Space, Return",
+	// the actions the file lists lose their old keys, the others keep theirs, and # starts a comment
+	// @param path is the controls file
+	bool load(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "r");
+		if (file == NULL)
+		{
+			return false;
+		}
+		bool listed[action_count] = {};
+		char line[256];
+		int number = 0;
+		while (fgets(line, sizeof(line), file) != NULL)
+		{
+			++number;
+			std::string text = line;
+			text = trim(text.substr(0, text.find('#')));
+			if (text.empty())
+			{
+				continue;
+			}
+			std::size_t equals = text.find('=');
+			int action = equals == std::string::npos ? action_count : parse_action(trim(text.substr(0, equals)));
+			if (action == action_count)
+			{
+				printf("%s:%d: unknown action\n", path.c_str(), number);
+				continue;
+			}
+			if (!listed[action])
+			{
+				listed[action] = true;
+				unbind(action);
+			}
+			std::string keys = text.substr(equals + 1);
+			std::size_t start = 0;
+			while (start <= keys.size())
+			{
+				std::size_t comma = std::min(keys.find(',', start), keys.size());
+				std::string name = trim(keys.substr(start, comma - start));
+				start = comma + 1;
+				if (name.empty())
+				{
+					continue;
+				}
+				SDL_Scancode scancode = SDL_GetScancodeFromName(name.c_str());
+				if (scancode == SDL_SCANCODE_UNKNOWN)
+				{
+					printf("%s:%d: unknown key %s\n", path.c_str(), number, name.c_str());
+				}
+				bind(scancode, action);
+			}
+		}
+		fclose(file);
+		return true;
+	}
+};
+
+// input_snapshot is the input of one tick, built once before the tick and only read by the systems
+struct input_snapshot
+{
+	// held has the bits of the actions held down after the tick's events
+	std::uint32_t held = 0;
+	// pressed has the bits of the actions that went down during the tick's events, even if they were released again
+	std::uint32_t pressed = 0;
+	// released has the bits of the actions that went up during the tick's events
+	std::uint32_t released = 0;
+	// mouse_x and mouse_y are the mouse position of the tick
+	std::int32_t mouse_x = 0;
+	std::int32_t mouse_y = 0;
+	// pressed_time holds the drain time of the event that pressed each action, valid for the actions in pressed
+	std::uint64_t pressed_time[action_count] = {};
+
+	// Returns true if an action is held down
+	bool down(int action) const
+	{
+		return (held & action_bit(action)) != 0;
+	}
+
+	// Returns true if an action went down during the tick
+	bool went_down(int action) const
+	{
+		return (pressed & action_bit(action)) != 0;
+	}
+
+	// Returns true if an action went up during the tick
+	bool went_up(int action) const
+	{
+		return (released & action_bit(action)) != 0;
+	}
+
+	// Returns the direction of two opposite actions, -1, 0 or 1
+	int axis(int negative, int positive) const
+	{
+		return (down(positive) ? 1 : 0) - (down(negative) ? 1 : 0);
+	}
+};
+
+// input_stage drains the key events of a tick into an input_snapshot
+// it remembers how many keys hold each action so two keys bound to the same action act as one
+struct input_stage
+{
+	// keys_down counts the bound keys held down for every action
+	int keys_down[action_count] = {};
+	// snapshot is the input of the current tick
+	input_snapshot snapshot;
+
+	// Builds the snapshot of a tick from its key events and mouse position
+	// @param input is the input of the tick
+	// @param controls maps the keys of the events to actions
+	const input_snapshot& update(const tick_input& input, const action_map& controls)
+	{
+		snapshot.pressed = 0;
+		snapshot.released = 0;
+		snapshot.mouse_x = input.mouse_x;
+		snapshot.mouse_y = input.mouse_y;
+		for (const input_event& event : input.events)
+		{
+			int action = controls.action(event.key);
+			if (action == action_count)
+			{
+				continue;
+			}
+			if (event.type == SDL_KEYDOWN)
+			{
+				if (keys_down[action]++ == 0)
+				{
+					snapshot.pressed |= action_bit(action);
+					snapshot.pressed_time[action] = event.time;
+					snapshot.held |= action_bit(action);
+				}
+			}
+			else if (keys_down[action] > 0 && --keys_down[action] == 0)
+			{
+				snapshot.released |= action_bit(action);
+				snapshot.held &= ~action_bit(action);
+			}
+		}
+		return snapshot;
+	}
+};
\ No newline at end of file
@@ -1,8 +1,34 @@
 #include "SDL.h"
+#include "benchmarks.cpp"
 
 int main(int argc, char* args[])
 {
+	// Run the benchmarks instead of the game when asked to, optionally only the one named after the flag,
+	// write the system benchmark results as JSON and compare them against a baseline
+	if (argc > 1 && std::string(args[1]) == "--bench")
+	{
+		benchmark_options options;
+		if (!read_benchmark_options(argc, args, 2, options))
+		{
+			return 1;
+		}
+		return run_benchmarks(options);
+	}
+
 	SDL sdl;
+	if (!sdl.ReadOptions(argc, args))
+	{
+		return 1;
+	}
+	if (!sdl.replayPath.empty())
+	{
+		return sdl.RunReplay() ? 0 : 1;
+	}
+	if (sdl.headless)
+	{
+		sdl.RunHeadless();
+		return 0;
+	}
 	if (sdl.Start())sdl.GameLoop();
 	return 0;
 }
\ No newline at end of file
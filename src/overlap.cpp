@@ -0,0 +1,257 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <SDL.h>
+
+// OVERLAP_SIMD is defined when the target has SSE2, the AVX2 kernel is compiled alongside it and picked at run time
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OVERLAP_SIMD
+#include <immintrin.h>
+#if defined(__GNUC__)
+#define OVERLAP_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define OVERLAP_AVX2_TARGET
+#endif
+#endif
+
+// aabb is an axis aligned bounding box given by its minimum and maximum corners
+struct aabb
+{
+	float min_x;
+	float min_y;
+	float max_x;
+	float max_y;
+};
+
+// Returns the bounding box of a rectangle
+// @param rect is the rectangle given by position and size
+inline aabb make_aabb(const SDL_FRect& rect)
+{
+	return { rect.x, rect.y, rect.x + rect.w, rect.y + rect.h };
+}
+
+// overlap_kernel selects the instruction set used to test boxes for overlap
+enum overlap_kernel
+{
+	// overlap_scalar tests one box at a time
+	overlap_scalar,
+	// overlap_sse2 tests four boxes per instruction
+	overlap_sse2,
+	// overlap_avx2 tests eight boxes per instruction
+	overlap_avx2
+};
+
+// Returns the widest kernel the processor supports
+inline overlap_kernel detect_overlap_kernel()
+{
+#ifdef OVERLAP_SIMD
+	if (SDL_HasAVX2())
+	{
+		return overlap_avx2;
+	}
+	if (SDL_HasSSE2())
+	{
+		return overlap_sse2;
+	}
+#endif
+	return overlap_scalar;
+}
+
+// Returns the name of a kernel for benchmark output
+inline const char* overlap_kernel_name(overlap_kernel kernel)
+{
+	switch (kernel)
+	{
+	case overlap_sse2:
+		return "sse2";
+	case overlap_avx2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+// aabb_soa stores boxes as one array per extent so the kernels load several boxes with one instruction
+struct aabb_soa
+{
+	std::vector<float> min_x;
+	std::vector<float> min_y;
+	std::vector<float> max_x;
+	std::vector<float> max_y;
+
+	// Removes every box
+	void clear()
+	{
+		min_x.clear();
+		min_y.clear();
+		max_x.clear();
+		max_y.clear();
+	}
+
+	// Adds a box at the end
+	void push_back(const aabb& box)
+	{
+		min_x.push_back(box.min_x);
+		min_y.push_back(box.min_y);
+		max_x.push_back(box.max_x);
+		max_y.push_back(box.max_y);
+	}
+
+	// Replaces the boxes with a list of boxes
+	void assign(const std::vector<aabb>& boxes)
+	{
+		clear();
+		for (const aabb& box : boxes)
+		{
+			push_back(box);
+		}
+	}
+
+	// Returns the number of boxes
+	std::size_t size() const
+	{
+		return min_x.size();
+	}
+};
+
+// Returns the smallest box holding two boxes
+inline aabb combine(const aabb& a, const aabb& b)
+{
+	return { std::min(a.min_x, b.min_x), std::min(a.min_y, b.min_y), std::max(a.max_x, b.max_x), std::max(a.max_y, b.max_y) };
+}
+
+// Returns true if two boxes overlap, boxes that only touch do not, the same rule as SDL_HasIntersectionF
+inline bool overlaps(const aabb& a, const aabb& b)
+{
+	return b.min_x < a.max_x && a.min_x < b.max_x && b.min_y < a.max_y && a.min_y < b.max_y;
+}
+
+// Appends the boxes of [begin, end) that overlap a box, one box at a time
+inline void overlap_range_scalar(const aabb& box, const aabb_soa& soa, std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t>& hits)
+{
+	for (std::uint32_t j = begin; j < end; ++j)
+	{
+		if (soa.min_x[j] < box.max_x && box.min_x < soa.max_x[j] && soa.min_y[j] < box.max_y && box.min_y < soa.max_y[j])
+		{
+			hits.push_back(j);
+		}
+	}
+}
+
+#ifdef OVERLAP_SIMD
+// Appends the boxes of [begin, end) that overlap a box, four boxes per instruction
+inline void overlap_range_sse2(const aabb& box, const aabb_soa& soa, std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t>& hits)
+{
+	__m128 box_min_x = _mm_set1_ps(box.min_x);
+	__m128 box_min_y = _mm_set1_ps(box.min_y);
+	__m128 box_max_x = _mm_set1_ps(box.max_x);
+	__m128 box_max_y = _mm_set1_ps(box.max_y);
+	std::uint32_t j = begin;
+	for (; j + 4 <= end; j += 4)
+	{
+		__m128 x = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&soa.min_x[j]), box_max_x), _mm_cmplt_ps(box_min_x, _mm_loadu_ps(&soa.max_x[j])));
+		__m128 y = _mm_and_ps(_mm_cmplt_ps(_mm_loadu_ps(&soa.min_y[j]), box_max_y), _mm_cmplt_ps(box_min_y, _mm_loadu_ps(&soa.max_y[j])));
+		int mask = _mm_movemask_ps(_mm_and_ps(x, y));
+		// Compact the set lanes into the hit list
+		while (mask != 0)
+		{
+			int lane = 0;
+			while (!(mask & (1 << lane)))
+			{
+				++lane;
+			}
+			hits.push_back(j + lane);
+			mask &= mask - 1;
+		}
+	}
+	overlap_range_scalar(box, soa, j, end, hits);
+}
+
+// Appends the boxes of [begin, end) that overlap a box, eight boxes per instruction
+OVERLAP_AVX2_TARGET inline void overlap_range_avx2(const aabb& box, const aabb_soa& soa, std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t>& hits)
+{
+	__m256 box_min_x = _mm256_set1_ps(box.min_x);
+	__m256 box_min_y = _mm256_set1_ps(box.min_y);
+	__m256 box_max_x = _mm256_set1_ps(box.max_x);
+	__m256 box_max_y = _mm256_set1_ps(box.max_y);
+	std::uint32_t j = begin;
+	for (; j + 8 <= end; j += 8)
+	{
+		__m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&soa.min_x[j]), box_max_x, _CMP_LT_OQ), _mm256_cmp_ps(box_min_x, _mm256_loadu_ps(&soa.max_x[j]), _CMP_LT_OQ));
+		__m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&soa.min_y[j]), box_max_y, _CMP_LT_OQ), _mm256_cmp_ps(box_min_y, _mm256_loadu_ps(&soa.max_y[j]), _CMP_LT_OQ));
+		int mask = _mm256_movemask_ps(_mm256_and_ps(x, y));
+		// Compact the set lanes into the hit list
+		while (mask != 0)
+		{
+			int lane = 0;
+			while (!(mask & (1 << lane)))
+			{
+				++lane;
+			}
+			hits.push_back(j + lane);
+			mask &= mask - 1;
+		}
+	}
+	overlap_range_scalar(box, soa, j, end, hits);
+}
+#endif
+
+// Appends the index of every box in [begin, end) of soa that overlaps a box
+// @param kernel is the instruction set to use, from detect_overlap_kernel
+// @param box is the box tested against the range
+// @param soa holds the boxes of the range
+// @param hits receives the indices of the overlapping boxes in increasing order
+inline void overlap_range(overlap_kernel kernel, const aabb& box, const aabb_soa& soa, std::uint32_t begin, std::uint32_t end, std::vector<std::uint32_t>& hits)
+{
+#ifdef OVERLAP_SIMD
+	if (kernel == overlap_avx2)
+	{
+		overlap_range_avx2(box, soa, begin, end, hits);
+		return;
+	}
+	if (kernel == overlap_sse2)
+	{
+		overlap_range_sse2(box, soa, begin, end, hits);
+		return;
+	}
+#endif
+	overlap_range_scalar(box, soa, begin, end, hits);
+}
+
+// Returns true if a box moving from a_from to a_to overlaps a box moving from b_from to b_to during the step
+// the boxes are assumed to move at a constant speed without changing size
+// @param toi receives the fraction of the step at which they first overlap, 0 if they overlap from the start
+inline bool swept_overlaps(const aabb& a_from, const aabb& a_to, const aabb& b_from, const aabb& b_to, float& toi)
+{
+	// Work in the frame of b, where a moves by the difference of the two displacements
+	float start[2] = { a_from.min_x, a_from.min_y };
+	float size[2] = { a_from.max_x - a_from.min_x, a_from.max_y - a_from.min_y };
+	float low[2] = { b_from.min_x, b_from.min_y };
+	float high[2] = { b_from.max_x, b_from.max_y };
+	float delta[2] = { (a_to.min_x - a_from.min_x) - (b_to.min_x - b_from.min_x), (a_to.min_y - a_from.min_y) - (b_to.min_y - b_from.min_y) };
+	float enter = 0;
+	float leave = 1;
+	for (int axis = 0; axis < 2; ++axis)
+	{
+		if (delta[axis] == 0)
+		{
+			if (!(start[axis] < high[axis] && low[axis] < start[axis] + size[axis]))
+			{
+				return false;
+			}
+			continue;
+		}
+		// Times at which the leading and the trailing edge of a cross b
+		float t0 = (low[axis] - (start[axis] + size[axis])) / delta[axis];
+		float t1 = (high[axis] - start[axis]) / delta[axis];
+		enter = std::max(enter, std::min(t0, t1));
+		leave = std::min(leave, std::max(t0, t1));
+		if (enter >= leave)
+		{
+			return false;
+		}
+	}
+	toi = enter;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <SDL.h>
+#include "stats.cpp"
+
+// PROFILE_SCOPE(name) times the rest of the enclosing block and records it under name, a string literal
+// defining PROFILER_DISABLED removes every scope at compile time
+#ifndef PROFILER_DISABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) profile_scope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+// profile_event is one timed scope
+struct profile_event
+{
+	// name is the string literal the scope was given
+	const char* name;
+	// start and end are performance counter values
+	Uint64 start;
+	Uint64 end;
+};
+
+// profile_buffer is the ring buffer of events recorded by one thread
+// only its own thread writes to it, so recording needs no lock, and count publishes the events to other threads reading them
+struct profile_buffer
+{
+	// thread is the number of the thread in the order threads first recorded, 0 for the first one
+	int thread = 0;
+	// events holds the most recent events, the oldest is overwritten once it is full
+	std::vector<profile_event> events;
+	// next is the slot the next event is written to
+	std::size_t next = 0;
+	// count is the number of events recorded, including the overwritten ones
+	// it is stored after the event is written, so a thread that loads it sees every event it counts
+	std::atomic<std::uint64_t> count{ 0 };
+
+	// Adds an event, overwriting the oldest one if the buffer is full
+	void add(const profile_event& event)
+	{
+		events[next] = event;
+		next = next + 1 == events.size() ? 0 : next + 1;
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// Returns the number of events recorded, including the overwritten ones
+	std::uint64_t recorded() const
+	{
+		return count.load(std::memory_order_acquire);
+	}
+
+	// Returns the number of events held
+	std::size_t size() const
+	{
+		return (std::size_t)std::min<std::uint64_t>(recorded(), events.size());
+	}
+
+	// Calls func with every event held that was recorded after cursor events, oldest first, and moves cursor to count
+	// @param cursor is the count at the last call
+	template <typename Func>
+	void since(std::uint64_t& cursor, Func func) const
+	{
+		std::uint64_t last = recorded();
+		std::uint64_t first = std::max(cursor, last - std::min<std::uint64_t>(last, events.size()));
+		for (std::uint64_t i = first; i < last; ++i)
+		{
+			func(events[(std::size_t)(i % events.size())]);
+		}
+		cursor = last;
+	}
+};
+
+// profile_summary is the timing of one scope name over the events held
+struct profile_summary
+{
+	std::string name;
+	std::size_t calls;
+	// mean, p95 and max are in seconds
+	double mean;
+	double p95;
+	double max;
+};
+
+// profiler owns the buffers of every thread that recorded and turns them into summaries and traces
+// summaries and traces read every buffer, so they should be taken while no other thread records
+struct profiler
+{
+	// capacity is the number of events each thread keeps
+	std::size_t capacity = 1 << 16;
+	// frequency is the number of performance counter ticks per second
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	// origin is the performance counter value trace times are measured from
+	Uint64 origin = SDL_GetPerformanceCounter();
+	std::vector<std::unique_ptr<profile_buffer>> buffers;
+	std::mutex lock;
+
+	// Creates the buffer of a thread that records for the first time
+	profile_buffer* add_thread()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		buffers.emplace_back(new profile_buffer());
+		profile_buffer* buffer = buffers.back().get();
+		buffer->thread = (int)buffers.size() - 1;
+		buffer->events.resize(capacity);
+		return buffer;
+	}
+
+	// Removes every recorded event
+	void clear()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (auto& buffer : buffers)
+		{
+			buffer->next = 0;
+			buffer->count.store(0, std::memory_order_release);
+		}
+	}
+
+	// Returns the timing of every scope name over the events held, slowest mean first
+	std::vector<profile_summary> summarize()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		std::map<std::string, sample_stats> stats;
+		for (auto& buffer : buffers)
+		{
+			for (std::size_t i = 0; i < buffer->size(); ++i)
+			{
+				const profile_event& event = buffer->events[i];
+				sample_stats& scope = stats[event.name];
+				scope.window = capacity;
+				scope.add((double)(event.end - event.start) / frequency);
+			}
+		}
+		std::vector<profile_summary> summaries;
+		for (auto& scope : stats)
+		{
+			summaries.push_back({ scope.first, scope.second.count, scope.second.mean, scope.second.percentile(0.95), scope.second.max });
+		}
+		std::sort(summaries.begin(), summaries.end(), [](const profile_summary& a, const profile_summary& b) { return a.mean > b.mean; });
+		return summaries;
+	}
+
+	// Prints the summary of every scope name in milliseconds
+	void print()
+	{
+		for (const profile_summary& summary : summarize())
+		{
+			printf("profile %-18s calls=%zu mean=%.4f ms p95=%.4f ms max=%.4f ms\n", summary.name.c_str(), summary.calls, summary.mean * 1e3, summary.p95 * 1e3, summary.max * 1e3);
+		}
+	}
+
+	// Writes the events held as Chrome trace event JSON, to open in chrome://tracing or Perfetto
+	// returns false if the file cannot be created
+	// @param path is the file to write
+	bool write_trace(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == NULL)
+		{
+			return false;
+		}
+		std::lock_guard<std::mutex> guard(lock);
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+		bool first = true;
+		for (auto& buffer : buffers)
+		{
+			// Write the events oldest first, the names are literals from the code and need no escaping
+			std::size_t held = buffer->size();
+			std::size_t oldest = held < buffer->events.size() ? 0 : buffer->next;
+			for (std::size_t i = 0; i < held; ++i)
+			{
+				const profile_event& event = buffer->events[(oldest + i) % buffer->events.size()];
+				double start = (double)(std::int64_t)(event.start - origin) * 1e6 / frequency;
+				double duration = (double)(event.end - event.start) * 1e6 / frequency;
+				fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",", event.name, buffer->thread, start, duration);
+				first = false;
+			}
+		}
+		fprintf(file, "\n]}\n");
+		fclose(file);
+		return true;
+	}
+};
+
+// Returns the profiler shared by the whole program
+inline profiler& global_profiler()
+{
+	static profiler instance;
+	return instance;
+}
+
+// Returns the buffer the calling thread records to
+inline profile_buffer& thread_profile_buffer()
+{
+	thread_local profile_buffer* buffer = global_profiler().add_thread();
+	return *buffer;
+}
+
+// profile_scope records the time from its construction to its destruction, used through PROFILE_SCOPE
+struct profile_scope
+{
+	const char* name;
+	Uint64 start;
+
+	explicit profile_scope(const char* name) : name(name), start(SDL_GetPerformanceCounter())
+	{
+	}
+
+	~profile_scope()
+	{
+		thread_profile_buffer().add({ name, start, SDL_GetPerformanceCounter() });
+	}
+};
\ No newline at end of file
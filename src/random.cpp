@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+
+// pcg32 is a small fast random number generator (PCG XSH RR 64/32) that gives the same numbers on every platform
+// a seed and a stream number together pick the sequence, so every spawner can own its own stream of the world seed
+// and draw from it independently of the others
+struct pcg32
+{
+	// state is the 64 bit generator state
+	std::uint64_t state = 0;
+	// increment selects the stream, it is odd once seeded and zero while the generator is unseeded
+	std::uint64_t increment = 0;
+
+	pcg32()
+	{
+	}
+
+	pcg32(std::uint64_t seed_value, std::uint64_t stream)
+	{
+		seed(seed_value, stream);
+	}
+
+	// Starts the sequence given by a seed and a stream number
+	// @param seed_value is the seed
+	// @param stream is the stream number
+	void seed(std::uint64_t seed_value, std::uint64_t stream)
+	{
+		state = 0;
+		increment = (stream << 1) | 1;
+		next();
+		state += seed_value;
+		next();
+	}
+
+	// Returns true once the generator has been seeded
+	bool seeded() const
+	{
+		return increment != 0;
+	}
+
+	// Returns the next 32 random bits
+	std::uint32_t next()
+	{
+		std::uint64_t old = state;
+		state = old * 6364136223846793005ULL + increment;
+		std::uint32_t shifted = (std::uint32_t)(((old >> 18) ^ old) >> 27);
+		std::uint32_t rotation = (std::uint32_t)(old >> 59);
+		return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+	}
+
+	// Returns a number in [0, bound) without the bias of a plain modulo
+	// @param bound is the number of possible results, it must not be zero
+	std::uint32_t bounded(std::uint32_t bound)
+	{
+		std::uint32_t threshold = (0u - bound) % bound;
+		for (;;)
+		{
+			std::uint32_t value = next();
+			if (value >= threshold)
+			{
+				return value % bound;
+			}
+		}
+	}
+
+	// Returns a number in [0, 1)
+	float uniform()
+	{
+		return (next() >> 8) * (1.0f / 16777216.0f);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,204 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <SDL.h>
+
+// input_event is a key press or release that reached the game, the only events the simulation reacts to
+struct input_event
+{
+	// type is SDL_KEYDOWN or SDL_KEYUP
+	std::uint32_t type;
+	// key is the SDL_Scancode of the key, so a replay does not depend on the keyboard layout
+	std::int32_t key;
+	// time is the performance counter value when the game drained the event, 0 when unknown, it is not recorded
+	std::uint64_t time = 0;
+};
+
+// tick_input is everything the player gave the simulation for one tick
+struct tick_input
+{
+	// events holds the key events applied before the tick
+	std::vector<input_event> events;
+	// mouse_x and mouse_y are the mouse position used for aiming during the tick
+	std::int32_t mouse_x = 0;
+	std::int32_t mouse_y = 0;
+};
+
+// replay_magic starts every replay file
+const char replay_magic[4] = { 'A', 'R', 'P', '3' };
+
+// replay_header is everything besides the input that a replay needs to play the recorded game again
+struct replay_header
+{
+	// seed is the world seed of the recorded game
+	std::uint64_t seed = 1;
+	// tick_rate is the tick rate of the recorded game, stored exactly
+	double tick_rate = 60;
+	// broad_phase is the broad phase the game was recorded with
+	std::uint8_t broad_phase = 0;
+	// scenario is the scenario file the game was recorded with, empty for the stock lanes, and scenario_hash
+	// the hash of its settings, 0 for the stock lanes
+	std::string scenario;
+	std::uint64_t scenario_hash = 0;
+};
+
+// input_recorder writes the input of every tick to a replay file
+// the file starts with the magic and the header: the world seed, the bits of the tick rate as a double, the broad
+// phase byte, the scenario hash and the 16 bit length and bytes of the scenario path
+// then comes one record per tick: a 16 bit event count, the 16 bit mouse position, and one byte for the type
+// and one for the key per event, all little endian
+// the events are recorded with the input_action of their key in key, so the key bindings of the player do not matter
+struct input_recorder
+{
+	FILE* file = NULL;
+	// buffer collects one tick record before it is written
+	std::vector<std::uint8_t> buffer;
+
+	// Creates the replay file and writes its header, returns false if it cannot be created
+	// @param path is the file to create
+	// @param header describes the recorded game
+	bool open(const std::string& path, const replay_header& header)
+	{
+		file = fopen(path.c_str(), "wb");
+		if (file == NULL)
+		{
+			return false;
+		}
+		std::uint64_t rate;
+		memcpy(&rate, &header.tick_rate, sizeof(rate));
+		buffer.assign(replay_magic, replay_magic + 4);
+		put(header.seed, 8);
+		put(rate, 8);
+		put(header.broad_phase, 1);
+		put(header.scenario_hash, 8);
+		put(header.scenario.size(), 2);
+		buffer.insert(buffer.end(), header.scenario.begin(), header.scenario.end());
+		fwrite(buffer.data(), 1, buffer.size(), file);
+		return true;
+	}
+
+	// Appends the input of one tick
+	// @param input is the input applied before the tick, with input actions in place of the keys
+	void write(const tick_input& input)
+	{
+		buffer.clear();
+		put(input.events.size(), 2);
+		put((std::uint16_t)input.mouse_x, 2);
+		put((std::uint16_t)input.mouse_y, 2);
+		for (const input_event& event : input.events)
+		{
+			put(event.type == SDL_KEYDOWN ? 1 : 0, 1);
+			put((std::uint8_t)event.key, 1);
+		}
+		fwrite(buffer.data(), 1, buffer.size(), file);
+	}
+
+	// Closes the file
+	void close()
+	{
+		if (file != NULL)
+		{
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+	// Appends the low bytes of a value to the buffer, least significant first
+	void put(std::uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+		{
+			buffer.push_back((std::uint8_t)(value >> (8 * i)));
+		}
+	}
+};
+
+// input_player reads the input of every tick back from a replay file
+struct input_player
+{
+	FILE* file = NULL;
+	// header describes the recorded game
+	replay_header header;
+
+	// Opens a replay file and reads its header, returns false if it is missing or not a replay
+	// @param path is the file to open
+	bool open(const std::string& path)
+	{
+		file = fopen(path.c_str(), "rb");
+		if (file == NULL)
+		{
+			return false;
+		}
+		char magic[4];
+		std::uint64_t rate, broad_phase, length;
+		if (fread(magic, 1, 4, file) != 4 || memcmp(magic, replay_magic, 4) != 0 || !get(header.seed, 8) || !get(rate, 8) ||
+			!get(broad_phase, 1) || !get(header.scenario_hash, 8) || !get(length, 2))
+		{
+			close();
+			return false;
+		}
+		memcpy(&header.tick_rate, &rate, sizeof(rate));
+		header.broad_phase = (std::uint8_t)broad_phase;
+		header.scenario.resize((std::size_t)length);
+		if (length > 0 && fread(&header.scenario[0], 1, (std::size_t)length, file) != length)
+		{
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	// Reads the input of the next tick, returns false at the end of the recording
+	// @param input receives the input, with input actions in place of the keys
+	bool read(tick_input& input)
+	{
+		std::uint64_t count, x, y;
+		if (!get(count, 2) || !get(x, 2) || !get(y, 2))
+		{
+			return false;
+		}
+		input.mouse_x = (std::int16_t)x;
+		input.mouse_y = (std::int16_t)y;
+		input.events.resize((std::size_t)count);
+		for (input_event& event : input.events)
+		{
+			std::uint64_t down, action;
+			if (!get(down, 1) || !get(action, 1))
+			{
+				return false;
+			}
+			event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+			event.key = (std::int32_t)action;
+		}
+		return true;
+	}
+
+	// Closes the file
+	void close()
+	{
+		if (file != NULL)
+		{
+			fclose(file);
+			file = NULL;
+		}
+	}
+
+	// Reads a little endian value of a number of bytes, returns false at the end of the file
+	bool get(std::uint64_t& value, int bytes)
+	{
+		std::uint8_t data[8];
+		if (fread(data, 1, bytes, file) != (std::size_t)bytes)
+		{
+			return false;
+		}
+		value = 0;
+		for (int i = 0; i < bytes; ++i)
+		{
+			value |= (std::uint64_t)data[i] << (8 * i);
+		}
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,237 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <SDL.h>
+#include "components.cpp"
+#include "input.cpp"
+
+// scenario describes a load to put the game under instead of the four stock asteroid lanes
+// it is read from a file of "key = value" lines, # starts a comment:
+//   spawners = 200          number of asteroid spawners
+//   spawn_rate = 10         asteroids each spawner spawns per second
+//   directions = right, left, up, down   lanes the spawners are dealt to in turn
+//   size = 20, 60           smallest and largest asteroid side, spread evenly over the spawners
+//   speed = 200             asteroid speed
+//   lifespan = 5            seconds an asteroid lives
+//   fire_rate = 4           bullets the player fires per second, at most one per tick
+//   duration = 60           seconds of game time to run, 0 runs until quit, --ticks wins headless
+// the population settles at about spawners * spawn_rate * lifespan asteroids
+struct scenario
+{
+	// largest_size bounds the asteroid sides, the height of the screen, so every asteroid fits across a lane
+	static const int largest_size = 480;
+
+	int spawners = 4;
+	double spawn_rate = 0.6;
+	// directions holds the unit velocity of every lane
+	std::vector<SDL_FPoint> directions = { { 1, 0 }, { -1, 0 }, { 0, -1 }, { 0, 1 } };
+	float size_min = 40;
+	float size_max = 40;
+	float speed = 200;
+	double lifespan = 5;
+	double fire_rate = 0;
+	double duration = 0;
+
+	// Reads a scenario file, returns false if it cannot be opened
+	// unknown keys and bad values are reported and skipped, the rest of the file still applies
+	// @param path is the scenario file
+	bool load(const std::string& path)
+	{
+		FILE* file = fopen(path.c_str(), "r");
+		if (file == NULL)
+		{
+			return false;
+		}
+		char line[256];
+		int number = 0;
+		while (fgets(line, sizeof(line), file) != NULL)
+		{
+			++number;
+			std::string text = line;
+			text = trim(text.substr(0, text.find('#')));
+			if (text.empty())
+			{
+				continue;
+			}
+			std::size_t equals = text.find('=');
+			std::string key = equals == std::string::npos ? text : trim(text.substr(0, equals));
+			std::string value = equals == std::string::npos ? "" : trim(text.substr(equals + 1));
+			if (!set(key, value))
+			{
+				printf("%s:%d: bad setting %s\n", path.c_str(), number, text.c_str());
+			}
+		}
+		fclose(file);
+		return true;
+	}
+
+	// Applies one setting, returns false if the key is unknown or the value is out of range
+	bool set(const std::string& key, const std::string& value)
+	{
+		double number = atof(value.c_str());
+		if (key == "spawners" && number >= 0)
+		{
+			spawners = (int)number;
+		}
+		else if (key == "spawn_rate" && number > 0)
+		{
+			spawn_rate = number;
+		}
+		else if (key == "speed" && number >= 0)
+		{
+			speed = (float)number;
+		}
+		else if (key == "lifespan" && number > 0)
+		{
+			lifespan = number;
+		}
+		else if (key == "fire_rate" && number >= 0)
+		{
+			fire_rate = number;
+		}
+		else if (key == "duration" && number >= 0)
+		{
+			duration = number;
+		}
+		else if (key == "size")
+		{
+			// One side for every asteroid, or the smallest and the largest, each above 0 and below the screen
+			std::size_t comma = value.find(',');
+			float smallest = (float)number;
+			float largest = comma == std::string::npos ? smallest : (float)atof(value.c_str() + comma + 1);
+			if (largest < smallest)
+			{
+				std::swap(smallest, largest);
+			}
+			if (smallest <= 0 || largest >= largest_size)
+			{
+				return false;
+			}
+			size_min = smallest;
+			size_max = largest;
+		}
+		else if (key == "directions")
+		{
+			return set_directions(value);
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+	// Reads a comma separated list of lanes, each one of right, left, up and down
+	bool set_directions(const std::string& value)
+	{
+		std::vector<SDL_FPoint> lanes;
+		std::size_t start = 0;
+		while (start <= value.size())
+		{
+			std::size_t comma = std::min(value.find(',', start), value.size());
+			std::string name = trim(value.substr(start, comma - start));
+			start = comma + 1;
+			if (name == "right")
+			{
+				lanes.push_back({ 1, 0 });
+			}
+			else if (name == "left")
+			{
+				lanes.push_back({ -1, 0 });
+			}
+			else if (name == "up")
+			{
+				lanes.push_back({ 0, -1 });
+			}
+			else if (name == "down")
+			{
+				lanes.push_back({ 0, 1 });
+			}
+			else
+			{
+				return false;
+			}
+		}
+		directions = lanes;
+		return true;
+	}
+
+	// Returns the spawners of the scenario, SDL::CreateWorld gives each one an entity
+	// their first spawns are spread evenly over one spawn period, so the population grows smoothly instead of in waves
+	std::vector<asteroid_component> make_spawners() const
+	{
+		std::vector<asteroid_component> result;
+		double delay = 1 / spawn_rate;
+		for (int i = 0; i < spawners; ++i)
+		{
+			// Deal the spawners to the lanes in turn and spread their sizes with the golden ratio sequence
+			const SDL_FPoint& direction = directions[i % directions.size()];
+			double spread = std::fmod(i * 0.6180339887, 1.0);
+			float size = size_min + (float)spread * (size_max - size_min);
+			asteroid_component spawner = { delay * (i + 1) / spawners, delay, direction.x, direction.y, size, size };
+			spawner.speed = speed;
+			spawner.lifespan = lifespan;
+			result.push_back(spawner);
+		}
+		return result;
+	}
+
+	// Adds the scripted input of a tick to the input the player gave, a tap of the fire key at the fire rate
+	// @param tick is the number of the tick from the start
+	// @param tick_rate is the number of ticks per second
+	// @param controls gives the key bound to fire
+	// @param input receives the events
+	void script(std::uint64_t tick, double tick_rate, const action_map& controls, tick_input& input) const
+	{
+		if (fire_rate <= 0)
+		{
+			return;
+		}
+		// Fire on the ticks where the count of bullets due goes up
+		if (std::floor((tick + 1) * fire_rate / tick_rate) > std::floor(tick * fire_rate / tick_rate))
+		{
+			std::int32_t key = controls.key_of(action_fire);
+			input.events.push_back({ SDL_KEYDOWN, key });
+			input.events.push_back({ SDL_KEYUP, key });
+		}
+	}
+
+	// Returns a hash of the settings that shape the game, everything but the duration, for replays to check
+	std::uint64_t hash() const
+	{
+		// FNV-1a over the bytes of every setting
+		std::uint64_t value = 14695981039346656037ull;
+		auto add = [&value](const void* data, std::size_t size)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				value = (value ^ bytes[i]) * 1099511628211ull;
+			}
+		};
+		add(&spawners, sizeof(spawners));
+		add(&spawn_rate, sizeof(spawn_rate));
+		for (const SDL_FPoint& direction : directions)
+		{
+			add(&direction, sizeof(direction));
+		}
+		add(&size_min, sizeof(size_min));
+		add(&size_max, sizeof(size_max));
+		add(&speed, sizeof(speed));
+		add(&lifespan, sizeof(lifespan));
+		add(&fire_rate, sizeof(fire_rate));
+		return value;
+	}
+
+	// Returns the number of ticks the scenario lasts, 0 if it has no duration
+	// @param tick_rate is the number of ticks per second
+	std::uint64_t ticks(double tick_rate) const
+	{
+		return (std::uint64_t)(duration * tick_rate + 0.5);
+	}
+};
\ No newline at end of file
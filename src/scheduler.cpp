@@ -0,0 +1,355 @@
+#pragma once
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "SDL.h"
+
+// system_resource numbers the shared state systems touch besides the component pools, after the pool bits
+enum system_resource
+{
+	// commands is the command buffer of the registry
+	commands_resource = pool_count,
+	// entities is the entity manager and the signatures, changed by creating entities
+	entities_resource,
+	resource_count
+};
+
+// resource_names are the names of the pools and resources in the order of their bits
+const char* const resource_names[resource_count] = { "sprites", "movements", "controllers", "velocities", "rotations", "trackers", "lifespans", "collisions", "asteroids", "commands", "entities" };
+
+// Returns the access bit of a component pool or a system_resource
+inline std::uint32_t access_bit(int resource)
+{
+	return 1u << resource;
+}
+
+// system_access is the set of pools and resources a system reads and the set it writes
+// writing implies reading, a set written needs no read bit
+struct system_access
+{
+	std::uint32_t reads;
+	std::uint32_t writes;
+
+	// Returns the bits two systems cannot touch at the same time, those one of them writes and the other uses
+	std::uint32_t conflicts(const system_access& other) const
+	{
+		return (writes & (other.reads | other.writes)) | (other.writes & reads);
+	}
+};
+
+// Returns the access of a sync point, it touches everything so nothing runs beside it
+inline system_access exclusive_access()
+{
+	return { 0, access_bit(resource_count) - 1 };
+}
+
+// thread_pool runs jobs on a fixed set of worker threads
+struct thread_pool
+{
+	std::vector<std::thread> workers;
+	std::vector<std::function<void()>> jobs;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	// Starts the workers
+	// @param count is the number of worker threads, the thread calling the scheduler is not counted
+	explicit thread_pool(int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			workers.emplace_back([this] { work(); });
+		}
+	}
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	// Queues a job for the next free worker
+	void push(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			jobs.push_back(std::move(job));
+		}
+		wake.notify_one();
+	}
+
+	// Runs one queued job on the calling thread, returns false if none was queued
+	bool run_one()
+	{
+		std::function<void()> job;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (jobs.empty())
+			{
+				return false;
+			}
+			job = std::move(jobs.back());
+			jobs.pop_back();
+		}
+		job();
+		return true;
+	}
+
+	// Runs queued jobs until the pool is destroyed
+	void work()
+	{
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [this] { return stopping || !jobs.empty(); });
+				if (stopping)
+				{
+					return;
+				}
+				job = std::move(jobs.back());
+				jobs.pop_back();
+			}
+			job();
+		}
+	}
+};
+
+// system_scheduler runs a list of systems as a dependency graph built from what they read and write
+// a system depends on every earlier system it conflicts with, so whatever the threads do, each pool and the command buffer
+// see their systems in the order they were added and the world ends exactly as in a serial run
+struct system_scheduler
+{
+	// task is one system in the graph
+	struct task
+	{
+		const char* name;
+		system_access access;
+		std::function<void()> run;
+		// before holds the tasks it waits for, after the tasks waiting for it, both without the ones implied by others
+		std::vector<std::size_t> before;
+		std::vector<std::size_t> after;
+		// ancestors has a bit for every task it waits for, directly or not
+		std::uint64_t ancestors;
+		// level is the length of the longest chain of tasks before it
+		int level;
+	};
+
+	// max_tasks is the most tasks a graph can hold, one per bit of the ancestor sets
+	static const std::size_t max_tasks = 64;
+
+	std::vector<task> tasks;
+
+	// pending counts the tasks each one still waits for and done the tasks finished in the current run
+	std::vector<int> pending;
+	std::size_t done = 0;
+	std::mutex lock;
+	std::condition_variable finished;
+
+	// Removes every task, the graph is rebuilt for each run
+	void clear()
+	{
+		tasks.clear();
+	}
+
+	// Adds a system after the ones already added and links it to the earlier systems it conflicts with
+	// an edge that an existing chain already implies is left out, so the graph only holds the orderings that matter
+	// @param name is the name of the system, a string literal
+	// @param access is what the system reads and writes
+	// @param run runs the system
+	void add(const char* name, system_access access, std::function<void()> run)
+	{
+		SDL_assert(tasks.size() < max_tasks);
+		task added = { name, access, std::move(run), {}, {}, 0, 0 };
+		std::size_t index = tasks.size();
+		for (std::size_t i = index; i-- > 0;)
+		{
+			if (access.conflicts(tasks[i].access) == 0 || (added.ancestors >> i & 1))
+			{
+				continue;
+			}
+			added.before.push_back(i);
+			added.ancestors |= tasks[i].ancestors | (std::uint64_t)1 << i;
+			added.level = std::max(added.level, tasks[i].level + 1);
+			tasks[i].after.push_back(index);
+		}
+		tasks.push_back(std::move(added));
+	}
+
+	// Returns the number of levels, the length of the longest chain of tasks
+	int depth() const
+	{
+		int levels = 0;
+		for (const task& t : tasks)
+		{
+			levels = std::max(levels, t.level + 1);
+		}
+		return levels;
+	}
+
+	// Returns the most tasks sharing a level, the threads the graph can keep busy at once
+	int width() const
+	{
+		std::vector<int> counts(depth(), 0);
+		int widest = 0;
+		for (const task& t : tasks)
+		{
+			widest = std::max(widest, ++counts[t.level]);
+		}
+		return widest;
+	}
+
+	// Runs every task on the calling thread in the order they were added
+	void run_serial()
+	{
+		for (task& t : tasks)
+		{
+			t.run();
+		}
+	}
+
+	// Runs the tasks on the pool and the calling thread, each one once all the tasks before it have finished
+	// @param pool is the pool the ready tasks are queued on, without workers the tasks run serially
+	void run(thread_pool& pool)
+	{
+		if (pool.workers.empty())
+		{
+			run_serial();
+			return;
+		}
+		pending.resize(tasks.size());
+		done = 0;
+		for (std::size_t i = 0; i < tasks.size(); ++i)
+		{
+			pending[i] = (int)tasks[i].before.size();
+		}
+		// Queue the tasks waiting for nothing, read from the graph since the workers start on pending at once
+		for (std::size_t i = 0; i < tasks.size(); ++i)
+		{
+			if (tasks[i].before.empty())
+			{
+				pool.push([this, &pool, i] { execute(pool, i); });
+			}
+		}
+
+		// Help with the queued tasks and sleep while the workers run the rest
+		std::unique_lock<std::mutex> guard(lock);
+		while (done < tasks.size())
+		{
+			guard.unlock();
+			bool ran = pool.run_one();
+			guard.lock();
+			if (!ran && done < tasks.size())
+			{
+				finished.wait(guard);
+			}
+		}
+	}
+
+	// Runs a task and queues the tasks it was the last one to wait for
+	void execute(thread_pool& pool, std::size_t index)
+	{
+		tasks[index].run();
+		std::size_t ready[max_tasks];
+		std::size_t count = 0;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			for (std::size_t next : tasks[index].after)
+			{
+				if (--pending[next] == 0)
+				{
+					ready[count++] = next;
+				}
+			}
+			++done;
+		}
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::size_t next = ready[i];
+			pool.push([this, &pool, next] { execute(pool, next); });
+		}
+		finished.notify_all();
+	}
+
+	// Returns true if an access is the one of a sync point
+	static bool exclusive(const system_access& access)
+	{
+		return access.writes == exclusive_access().writes;
+	}
+
+	// Returns the names of the pools and resources in a set of access bits, separated by spaces, or none
+	static std::string describe(std::uint32_t bits)
+	{
+		std::string names;
+		for (int i = 0; i < resource_count; ++i)
+		{
+			if (bits & access_bit(i))
+			{
+				names += names.empty() ? "" : " ";
+				names += resource_names[i];
+			}
+		}
+		return names.empty() ? "none" : names;
+	}
+
+	// Writes the graph as Graphviz dot, one row per level, each edge labelled with what the two tasks conflict on
+	// returns false if the file cannot be created
+	// @param path is the file to write
+	bool write_dot(const std::string& path) const
+	{
+		FILE* file = fopen(path.c_str(), "w");
+		if (file == NULL)
+		{
+			return false;
+		}
+		fprintf(file, "digraph schedule {\n\trankdir=TB;\n\tnode [shape=box, fontname=\"monospace\"];\n");
+		for (std::size_t i = 0; i < tasks.size(); ++i)
+		{
+			const task& t = tasks[i];
+			if (exclusive(t.access))
+			{
+				fprintf(file, "\tt%zu [label=\"%s\\nsync point\", style=filled, fillcolor=lightgray];\n", i, t.name);
+				continue;
+			}
+			fprintf(file, "\tt%zu [label=\"%s\\nreads: %s\\nwrites: %s\"];\n", i, t.name, describe(t.access.reads & ~t.access.writes).c_str(), describe(t.access.writes).c_str());
+		}
+		for (int level = 0; level < depth(); ++level)
+		{
+			fprintf(file, "\t{ rank=same;");
+			for (std::size_t i = 0; i < tasks.size(); ++i)
+			{
+				if (tasks[i].level == level)
+				{
+					fprintf(file, " t%zu;", i);
+				}
+			}
+			fprintf(file, " }\n");
+		}
+		for (std::size_t i = 0; i < tasks.size(); ++i)
+		{
+			for (std::size_t before : tasks[i].before)
+			{
+				// A sync point conflicts with everything, its edges need no label
+				bool sync = exclusive(tasks[i].access) || exclusive(tasks[before].access);
+				fprintf(file, "\tt%zu -> t%zu [label=\"%s\"];\n", before, i, sync ? "" : describe(tasks[i].access.conflicts(tasks[before].access)).c_str());
+			}
+		}
+		fprintf(file, "}\n");
+		fclose(file);
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+// sample_stats summarizes a stream of timings, such as frame times
+// mean, spread and extremes cover every sample, percentiles cover the most recent window of samples
+struct sample_stats
+{
+	// window is the number of recent samples kept for percentiles
+	std::size_t window = 4096;
+	// recent holds the last window samples as a ring buffer
+	std::vector<double> recent;
+	// next is the slot of recent the next sample overwrites once it is full
+	std::size_t next = 0;
+	// count is the number of samples added
+	std::size_t count = 0;
+	double mean = 0;
+	// m2 is the sum of squared differences from the mean, updated with Welford's method
+	double m2 = 0;
+	double min = 0;
+	double max = 0;
+	// sorted is scratch space for percentile
+	mutable std::vector<double> sorted;
+
+	// Adds a sample
+	// @param value is the sample
+	void add(double value)
+	{
+		if (recent.size() < window)
+		{
+			recent.push_back(value);
+		}
+		else
+		{
+			recent[next] = value;
+			next = (next + 1) % window;
+		}
+		++count;
+		double delta = value - mean;
+		mean += delta / count;
+		m2 += delta * (value - mean);
+		min = count == 1 ? value : std::min(min, value);
+		max = count == 1 ? value : std::max(max, value);
+	}
+
+	// Returns the standard deviation of the samples, the jitter of a stream of frame times
+	double stddev() const
+	{
+		return count > 1 ? std::sqrt(m2 / (count - 1)) : 0;
+	}
+
+	// Returns the sample below which a fraction of the recent samples fall
+	// @param fraction is between 0 and 1, 0.99 gives the 99th percentile
+	double percentile(double fraction) const
+	{
+		if (recent.empty())
+		{
+			return 0;
+		}
+		sorted = recent;
+		std::size_t rank = (std::size_t)std::ceil(fraction * sorted.size());
+		rank = rank == 0 ? 0 : std::min(rank, sorted.size()) - 1;
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+
+	// Removes every sample
+	void clear()
+	{
+		recent.clear();
+		next = 0;
+		count = 0;
+		mean = 0;
+		m2 = 0;
+		min = 0;
+		max = 0;
+	}
+};
\ No newline at end of file
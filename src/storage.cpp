@@ -0,0 +1,185 @@
+#pragma once
+#include <vector>
+#include <tuple>
+#include <cstddef>
+#include <utility>
+#include "entities.cpp"
+
+// sparse_set stores the components of one type for all entities that own it
+// components are packed contiguously so systems iterate them without chasing pointers,
+// and the sparse array maps an entity index straight to its slot for O(1) lookups
+template <typename T>
+struct sparse_set
+{
+	// components holds the packed component data
+	std::vector<T> components;
+	// entities holds the full handle of the owner of each slot in components
+	std::vector<entity> entities;
+	// sparse maps an entity index to its slot in components plus one, zero means the index has no component
+	std::vector<std::size_t> sparse;
+	// signature_bit is the bit the registry sets in the signature of entities owning a component in this set
+	std::uint32_t signature_bit = 0;
+
+	// Returns true if the entity owns a component in this set, stale handles of a reused index do not
+	// @param id is the entity to look up
+	bool contains(entity id) const
+	{
+		std::uint32_t index = entity_index(id);
+		return index < sparse.size() && sparse[index] != 0 && entities[sparse[index] - 1] == id;
+	}
+
+	// Returns the component of an entity, the entity must own one
+	// @param id is the entity to look up
+	T& get(entity id)
+	{
+		return components[sparse[entity_index(id)] - 1];
+	}
+
+	// Returns the component of an entity, the entity must own one
+	// @param id is the entity to look up
+	const T& get(entity id) const
+	{
+		return components[sparse[entity_index(id)] - 1];
+	}
+
+	// Returns a pointer to the component of an entity or nullptr if it has none
+	// @param id is the entity to look up
+	T* try_get(entity id)
+	{
+		return contains(id) ? &components[sparse[entity_index(id)] - 1] : nullptr;
+	}
+
+	// Adds a component to an entity or overwrites the one it already has
+	// @param id is the entity receiving the component
+	// @param value is the component data
+	T& emplace(entity id, const T& value)
+	{
+		std::uint32_t index = entity_index(id);
+		if (index >= sparse.size())
+		{
+			sparse.resize(index + 1, 0);
+		}
+		if (sparse[index] != 0)
+		{
+			// The slot belongs to this entity or to a stale handle of the same index, reuse it either way
+			entities[sparse[index] - 1] = id;
+			return components[sparse[index] - 1] = value;
+		}
+		components.push_back(value);
+		entities.push_back(id);
+		sparse[index] = components.size();
+		return components.back();
+	}
+
+	// Removes the component of an entity by moving the last component into its slot
+	// @param id is the entity losing the component
+	void erase(entity id)
+	{
+		if (!contains(id))
+		{
+			return;
+		}
+		std::uint32_t index = entity_index(id);
+		std::size_t slot = sparse[index] - 1;
+		std::size_t last = components.size() - 1;
+		if (slot != last)
+		{
+			components[slot] = components[last];
+			entities[slot] = entities[last];
+			sparse[entity_index(entities[slot])] = slot + 1;
+		}
+		components.pop_back();
+		entities.pop_back();
+		sparse[index] = 0;
+	}
+
+	// Removes every component from the set
+	void clear()
+	{
+		components.clear();
+		entities.clear();
+		sparse.clear();
+	}
+
+	// Returns the number of components in the set
+	std::size_t size() const
+	{
+		return components.size();
+	}
+
+	// Returns true if the set holds no components
+	bool empty() const
+	{
+		return components.empty();
+	}
+};
+
+// component_view visits every entity that owns all of the requested component types
+// it walks the smallest of the pools and resolves the others with one sparse lookup each
+// callbacks must not add or remove components of the viewed pools, adding can move the packed components the callback
+// holds references to, so structural changes go through reg.commands and are applied when the registry flushes
+template <typename... Ts>
+struct component_view
+{
+	// pools holds the sets the view reads from
+	std::tuple<sparse_set<Ts>*...> pools;
+
+	component_view(sparse_set<Ts>&... sets) : pools(&sets...)
+	{
+	}
+
+	// Calls func(entity, Ts&...) once for each matching entity
+	// @param func is the callback receiving the entity and its components
+	template <typename Func>
+	void each(Func func)
+	{
+		each_indexed(func, std::index_sequence_for<Ts...>());
+	}
+
+	// Walks the pool with the fewest components, whose slot of each entity is already known, and looks up the others
+	template <typename Func, std::size_t... Is>
+	void each_indexed(Func& func, std::index_sequence<Is...>)
+	{
+		const std::vector<entity>* lists[] = { &std::get<Is>(pools)->entities... };
+		std::size_t driver = 0;
+		for (std::size_t i = 1; i < sizeof...(Ts); ++i)
+		{
+			if (lists[i]->size() < lists[driver]->size())
+			{
+				driver = i;
+			}
+		}
+		const std::vector<entity>& ids = *lists[driver];
+		for (std::size_t slot = 0; slot < ids.size(); ++slot)
+		{
+			entity id = ids[slot];
+			visit(func, id, fetch<Is>(driver, slot, id)...);
+		}
+	}
+
+	// Returns the component of pool I for an entity, read from its slot when pool I is the one walked
+	// @param driver is the index of the walked pool
+	// @param slot is the slot of the entity in the walked pool
+	// @param id is the entity
+	template <std::size_t I>
+	typename std::tuple_element<I, std::tuple<Ts...>>::type* fetch(std::size_t driver, std::size_t slot, entity id)
+	{
+		auto* set = std::get<I>(pools);
+		return I == driver ? &set->components[slot] : set->try_get(id);
+	}
+
+	// Forwards the components to the callback if the entity owns all of them
+	template <typename Func>
+	static void visit(Func& func, entity id, Ts*... components)
+	{
+		bool present[] = { (components != nullptr)... };
+		for (bool found : present)
+		{
+			if (!found)
+			{
+				return;
+			}
+		}
+		func(id, *components...);
+	}
+};
\ No newline at end of file
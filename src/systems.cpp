@@ -3,32 +3,36 @@
 #include <SDL.h>
 #include <string>
 #include "SDL.h"
+#include "broadphase.cpp"
+#include "scheduler.cpp"
 #include <iostream>
-
-using entity = std::size_t;
+#include <memory>
 
 // mobility_system updates the position of entities based on their movement components
 // @param reg is the memory adress to the registry struct
 // @param deltatime is the time between frames
 struct mobility_system
 {
+	// Reads the controllers, writes the movements and the sprites
+	static system_access access()
+	{
+		return { access_bit(controller_pool), access_bit(movement_pool) | access_bit(sprite_pool) };
+	}
+
 	void update(registry& reg, double deltaTime)
 	{
-		for (auto& it : reg.movements)
+		PROFILE_SCOPE("mobility_system");
+		reg.view<movement_component, sprite_component>().each([&](entity id, movement_component& movement, sprite_component& sprite)
 		{
-			if (reg.sprites.find(it.first) == reg.sprites.end())
+			controller_component* controller = reg.controllers.try_get(id);
+			if (controller != nullptr)
 			{
-				continue;
+				movement.vel_x = controller->controller_x;
+				movement.vel_y = controller->controller_y;
 			}
 
-			if (reg.controllers.find(it.first) != reg.controllers.end())
-			{
-				it.second.vel_x = reg.controllers[it.first].controller_x;
-				it.second.vel_y = reg.controllers[it.first].controller_y;
-			}
-
-			float tempX = it.second.vel_x;
-			float tempY = it.second.vel_y;
+			float tempX = movement.vel_x;
+			float tempY = movement.vel_y;
 
 			float diff = sqrt(pow(tempX, 2) + pow(tempY, 2));
 
@@ -38,70 +42,99 @@ struct mobility_system
 				tempY /= diff;
 			}
 
-			reg.sprites[it.first].src.x += tempX * deltaTime * it.second.speed;
-			reg.sprites[it.first].src.y += tempY * deltaTime * it.second.speed;
-		}
+			sprite.src.x += tempX * deltaTime * movement.speed;
+			sprite.src.y += tempY * deltaTime * movement.speed;
+		});
 	}
 };
 
 // sprite_system renders the sprites of entities
+// sprites are drawn between their state before and after the last simulation tick so motion stays smooth
+// when the frame rate differs from the tick rate
 // @param reg is the memory adress to the registry struct
 // @param renderer is the SDL renderer used to render
+// @param alpha is how far the frame is past the last tick, from 0 to 1
 struct sprite_system
 {
-	void update(registry& reg, SDL_Renderer* renderer)
+	// sprite_state is the position and angle of a sprite before the last tick
+	struct sprite_state
 	{
-		for (auto& it : reg.sprites)
+		float x;
+		float y;
+		float angle;
+	};
+
+	// previous holds the state of every sprite before the last tick
+	sparse_set<sprite_state> previous;
+
+	// Reads the sprites
+	static system_access access()
+	{
+		return { access_bit(sprite_pool), 0 };
+	}
+
+	// Records the state of every sprite, called before each simulation tick
+	void snapshot(registry& reg)
+	{
+		previous.clear();
+		reg.view<sprite_component>().each([&](entity id, sprite_component& sprite)
 		{
-			SDL_RenderCopyExF(renderer, it.second.texture, NULL, &it.second.src, it.second.angle, NULL, SDL_FLIP_NONE);
-		}
+			previous.emplace(id, { sprite.src.x, sprite.src.y, sprite.angle });
+		});
 	}
-};
 
-// controller_system updates the controller components based on user input
-// @param reg is the memory adress to the registry struct
-// @param e is the event variable used by SDL
-struct controller_system
-{
-	void update(registry& reg, SDL_Event& e)
+	void update(registry& reg, SDL_Renderer* renderer, double alpha = 1)
 	{
-		for (auto& it : reg.controllers)
+		PROFILE_SCOPE("sprite_system");
+		float t = (float)alpha;
+		reg.view<sprite_component>().each([&](entity id, sprite_component& sprite)
 		{
-			if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
+			const sprite_state* last = previous.try_get(id);
+			if (last == nullptr)
 			{
-				switch (e.key.keysym.sym)
-				{
-				case SDLK_UP: it.second.controller_y--; break;
-				case SDLK_w: it.second.controller_y--; break;
-
-				case SDLK_DOWN: it.second.controller_y++; break;
-				case SDLK_s: it.second.controller_y++; break;
-
-				case SDLK_LEFT: it.second.controller_x--; break;
-				case SDLK_a: it.second.controller_x--; break;
-
-				case SDLK_RIGHT: it.second.controller_x++; break;
-				case SDLK_d: it.second.controller_x++; break;
-				}
+				// Sprites created during the last tick have nothing to interpolate from
+				SDL_RenderCopyExF(renderer, sprite.texture, NULL, &sprite.src, sprite.angle, NULL, SDL_FLIP_NONE);
+				return;
 			}
-			else if (e.type == SDL_KEYUP && e.key.repeat == 0)
+			SDL_FRect rect = sprite.src;
+			rect.x = last->x + (sprite.src.x - last->x) * t;
+			rect.y = last->y + (sprite.src.y - last->y) * t;
+			// Turn the short way around the circle
+			float turn = std::fmod(sprite.angle - last->angle, 360.0f);
+			if (turn > 180)
 			{
-				switch (e.key.keysym.sym)
-				{
-				case SDLK_UP: it.second.controller_y++; break;
-				case SDLK_w: it.second.controller_y++; break;
-
-				case SDLK_DOWN: it.second.controller_y--; break;
-				case SDLK_s: it.second.controller_y--; break;
+				turn -= 360;
+			}
+			else if (turn < -180)
+			{
+				turn += 360;
+			}
+			SDL_RenderCopyExF(renderer, sprite.texture, NULL, &rect, last->angle + turn * t, NULL, SDL_FLIP_NONE);
+		});
+	}
+};
 
-				case SDLK_LEFT: it.second.controller_x++; break;
-				case SDLK_a: it.second.controller_x++; break;
+// controller_system updates the controller components based on user input
+// @param reg is the memory adress to the registry struct
+// @param input is the input snapshot of the tick
+struct controller_system
+{
+	// Writes the controllers
+	static system_access access()
+	{
+		return { 0, access_bit(controller_pool) };
+	}
 
-				case SDLK_RIGHT: it.second.controller_x--; break;
-				case SDLK_d: it.second.controller_x--; break;
-				}
-			}
-		}
+	void update(registry& reg, const input_snapshot& input)
+	{
+		PROFILE_SCOPE("controller_system");
+		int x = input.axis(action_left, action_right);
+		int y = input.axis(action_up, action_down);
+		reg.view<controller_component>().each([&](entity, controller_component& controller)
+		{
+			controller.controller_x = x;
+			controller.controller_y = y;
+		});
 	}
 };
 
@@ -110,28 +143,27 @@ struct controller_system
 // @param deltatime is the time between frames
 struct velocity_system
 {
+	// Reads the controllers, writes the velocities and the sprites
+	static system_access access()
+	{
+		return { access_bit(controller_pool), access_bit(velocity_pool) | access_bit(sprite_pool) };
+	}
+
 	void update(registry& reg, double deltaTime)
 	{
-		for (auto& it : reg.velocities)
+		PROFILE_SCOPE("velocity_system");
+		reg.view<velocity_component, sprite_component, controller_component>().each([&](entity, velocity_component& velocity, sprite_component& sprite, controller_component& controller)
 		{
-			if (reg.sprites.find(it.first) == reg.sprites.end())
-			{
-				continue;
-			}
-			if (reg.controllers.find(it.first) == reg.controllers.end())
-			{
-				continue;
-			}
-
-			it.second.vel_x += reg.controllers[it.first].controller_x * deltaTime * it.second.speed;
-			it.second.vel_y += reg.controllers[it.first].controller_y * deltaTime * it.second.speed;
+			velocity.vel_x += controller.controller_x * deltaTime * velocity.speed;
+			velocity.vel_y += controller.controller_y * deltaTime * velocity.speed;
 
-			it.second.vel_x *= pow(it.second.drag, deltaTime);
-			it.second.vel_y *= pow(it.second.drag, deltaTime);
+			double damping = pow(velocity.drag, deltaTime);
+			velocity.vel_x *= damping;
+			velocity.vel_y *= damping;
 
-			reg.sprites[it.first].src.x += it.second.vel_x * deltaTime;
-			reg.sprites[it.first].src.y += it.second.vel_y * deltaTime;
-		}
+			sprite.src.x += velocity.vel_x * deltaTime;
+			sprite.src.y += velocity.vel_y * deltaTime;
+		});
 	}
 };
 
@@ -140,50 +172,54 @@ struct velocity_system
 // @param deltatime is the time between frames
 struct rotation_system
 {
+	// Reads the rotations, writes the sprites
+	static system_access access()
+	{
+		return { access_bit(rotation_pool), access_bit(sprite_pool) };
+	}
+
 	void update(registry& reg, double deltaTime)
 	{
-		for (auto& it : reg.rotations)
+		PROFILE_SCOPE("rotation_system");
+		reg.view<rotation_component, sprite_component>().each([&](entity, rotation_component& rotation, sprite_component& sprite)
 		{
-			if (reg.sprites.find(it.first) == reg.sprites.end())
-			{
-				continue;
-			}
-
-			reg.sprites[it.first].angle += it.second.deviation * deltaTime;
-		}
+			sprite.angle += rotation.deviation * deltaTime;
+		});
 	}
 };
 
 // tracking_system updates the rotation angle of entities to track a target or the mouse
 // @param reg is the memory adress to the registry struct
+// @param mouse_x and mouse_y are the mouse position of the tick
 struct tracking_system
 {
-	void update(registry& reg)
+	// Reads the trackers, writes the sprites, the target sprites are read from the same pool
+	static system_access access()
 	{
-		for (auto& it : reg.trackers)
+		return { access_bit(tracking_pool), access_bit(sprite_pool) };
+	}
+
+	void update(registry& reg, int mouse_x, int mouse_y)
+	{
+		PROFILE_SCOPE("tracking_system");
+		reg.view<tracking_component, sprite_component>().each([&](entity, tracking_component& tracker, sprite_component& sprite)
 		{
-			if (reg.sprites.find(it.first) == reg.sprites.end())
-			{
-				continue;
-			}
-			if (it.second.follow_mouse)
+			if (tracker.follow_mouse)
 			{
-				int mouse_x, mouse_y;
-				SDL_GetMouseState(&mouse_x, &mouse_y);
-
-				float angle_deg = atan2(mouse_y - reg.sprites[it.first].src.y - reg.sprites[it.first].src.h / 2, mouse_x - reg.sprites[it.first].src.x - reg.sprites[it.first].src.w / 2) * 180.0 / M_PI;
+				float angle_deg = atan2(mouse_y - sprite.src.y - sprite.src.h / 2, mouse_x - sprite.src.x - sprite.src.w / 2) * 180.0 / M_PI;
 
-				reg.sprites[it.first].angle = angle_deg + 90;
-				continue;
+				sprite.angle = angle_deg + 90;
+				return;
 			}
-			if (reg.sprites.find(it.second.target) == reg.sprites.end())
+			sprite_component* target = reg.sprites.try_get(tracker.target);
+			if (target == nullptr)
 			{
-				continue;
+				return;
 			}
-			float angle_deg = atan2(reg.sprites[it.second.target].src.y + reg.sprites[it.second.target].src.h / 2 - reg.sprites[it.first].src.y - reg.sprites[it.first].src.h / 2, reg.sprites[it.second.target].src.x + reg.sprites[it.second.target].src.w / 2 - reg.sprites[it.first].src.x - reg.sprites[it.first].src.w / 2) * 180.0 / M_PI;
+			float angle_deg = atan2(target->src.y + target->src.h / 2 - sprite.src.y - sprite.src.h / 2, target->src.x + target->src.w / 2 - sprite.src.x - sprite.src.w / 2) * 180.0 / M_PI;
 
-			reg.sprites[it.first].angle = angle_deg + 90;
-		}
+			sprite.angle = angle_deg + 90;
+		});
 	}
 };
 
@@ -192,121 +228,294 @@ struct tracking_system
 // @param deltatime is the time between frames
 struct lifespan_system
 {
+	// Writes the lifespans and records the destruction of the expired entities
+	static system_access access()
+	{
+		return { 0, access_bit(lifespan_pool) | access_bit(commands_resource) };
+	}
+
 	void update(registry& reg, double deltaTime)
 	{
-		for (auto it = reg.lifespans.begin(); it != reg.lifespans.end(); )
+		PROFILE_SCOPE("lifespan_system");
+		reg.view<lifespan_component>().each([&](entity id, lifespan_component& lifespan)
 		{
-			it->second.lifespan -= deltaTime;
-			if (it->second.lifespan <= 0)
-			{
-				if (reg.sprites.find(it->first) != reg.sprites.end())
-				{
-					reg.sprites.erase(it->first);
-				}
-				if (reg.movements.find(it->first) != reg.movements.end())
-				{
-					reg.movements.erase(it->first);
-				}
-				if (reg.controllers.find(it->first) != reg.controllers.end())
-				{
-					reg.controllers.erase(it->first);
-				}
-				if (reg.velocities.find(it->first) != reg.velocities.end())
-				{
-					reg.velocities.erase(it->first);
-				}
-				if (reg.rotations.find(it->first) != reg.rotations.end())
-				{
-					reg.rotations.erase(it->first);
-				}
-				if (reg.trackers.find(it->first) != reg.trackers.end())
-				{
-					reg.trackers.erase(it->first);
-				}
-				if (reg.collisions.find(it->first) != reg.collisions.end())
-				{
-					reg.collisions.erase(it->first);
-				}
-				it = reg.lifespans.erase(it);
-			}
-			else
+			lifespan.lifespan -= deltaTime;
+			if (lifespan.lifespan <= 0)
 			{
-				++it;
+				reg.commands.destroy(id);
 			}
-		}
+		});
 	}
 };
 
 // collision_system handles collisions between entities
 // @param reg is the memory adress to the registry struct
+// @param deltatime is the time between frames, the moving colliders are swept back over it
 struct collision_system
 {
-	void update(registry& reg)
+	// collider is a collision entity with its layer gathered once per frame
+	// from and to are the boxes at the start and the end of the step, they differ for the colliders that moved
+	struct collider
+	{
+		entity id;
+		std::uint32_t layer;
+		bool continuous;
+		aabb from;
+		aabb to;
+	};
+
+	// last_box is the box a continuous collider had at the last update
+	struct last_box
+	{
+		aabb box;
+		std::uint32_t frame;
+	};
+
+	// swept_hit is a pair with a continuous collider whose paths meet, toi is the fraction of the step at which they first touch
+	struct swept_hit
+	{
+		collider first;
+		collider second;
+		float toi;
+	};
+
+	// mode is the broad phase used to find overlapping pairs
+	broad_phase mode = broad_phase_grid;
+
+	// grid is the uniform grid broad phase, rebuilt every frame
+	uniform_grid grid;
+
+	// sweep is the sweep and prune broad phase, kept sorted between frames
+	sweep_and_prune sweep;
+
+	// tree is the dynamic aabb tree broad phase, kept between frames and open to region and ray queries
+	aabb_tree tree;
+
+	// colliders holds the gathered entities, reused between frames
+	std::vector<collider> colliders;
+
+	// ids holds the entity of each collider for the broad phase
+	std::vector<entity> ids;
+
+	// boxes holds the bounding box of each collider for the broad phase
+	std::vector<aabb> boxes;
+
+	// filters holds the collision filter of each collider for the broad phase
+	std::vector<collision_filter> filters;
+
+	// pairs holds the overlapping pairs found by the broad phase
+	std::vector<collision_pair> pairs;
+
+	// soa holds the boxes split by extent for the overlap kernel of the all pairs loop
+	aabb_soa soa;
+
+	// hits receives the overlap kernel results
+	std::vector<std::uint32_t> hits;
+
+	// kernel is the instruction set used by the overlap kernel
+	overlap_kernel kernel = detect_overlap_kernel();
+
+	// last_boxes holds the box of every continuous collider at the last update, the start of its next sweep
+	sparse_set<last_box> last_boxes;
+
+	// stale holds the continuous colliders that disappeared since the last update
+	std::vector<entity> stale;
+
+	// swept_hits holds the hits of the continuous colliders of the current update, applied in the order they happen
+	std::vector<swept_hit> swept_hits;
+
+	// spent holds the colliders a swept hit of the current update destroyed
+	sparse_set<std::uint8_t> spent;
+
+	// frame counts the updates, it stamps the entries of last_boxes that are still in use
+	std::uint32_t frame = 0;
+
+	// tested counts the pairs the broad phase passed on to resolve in the last update
+	std::size_t tested = 0;
+
+	// masks holds the layers each layer reacts to, read from collision_matrix
+	std::uint32_t masks[layer_count];
+
+	// Reads the collisions, the sprites and the movements, records the responses
+	static system_access access()
+	{
+		return { access_bit(collision_pool) | access_bit(sprite_pool) | access_bit(movement_pool), access_bit(commands_resource) };
+	}
+
+	collision_system()
+	{
+		for (int i = 0; i < layer_count; ++i)
+		{
+			masks[i] = collision_mask(1u << i);
+		}
+	}
+
+	void update(registry& reg, double deltaTime = 0)
 	{
-		for (auto it1 = reg.collisions.begin(); it1 != reg.collisions.end(); )
+		PROFILE_SCOPE("collision_system");
+		colliders.clear();
+		ids.clear();
+		boxes.clear();
+		filters.clear();
+		swept_hits.clear();
+		tested = 0;
+		++frame;
+		reg.view<collision_component, sprite_component>().each([&](entity id, collision_component& collision, sprite_component& sprite)
 		{
-			if (reg.sprites.find(it1->first) == reg.sprites.end())
+			aabb to = make_aabb(sprite.src);
+			aabb from = to;
+			last_box* last = collision.continuous ? last_boxes.try_get(id) : nullptr;
+			movement_component* movement = reg.movements.try_get(id);
+			if (last != nullptr)
 			{
-				++it1;
-				continue;
+				// Sweep from where the collider was at the last update
+				from = last->box;
 			}
-			for (auto it2 = reg.collisions.begin(); it2 != reg.collisions.end(); )
+			else if (movement != nullptr && deltaTime > 0)
 			{
-				if (it1 == it2)
-				{
-					++it2;
-					continue;
-				}
-				if (reg.sprites.find(it2->first) == reg.sprites.end())
-				{
-					++it2;
-					continue;
-				}
-				if (!SDL_HasIntersectionF(&reg.sprites[it1->first].src, &reg.sprites[it2->first].src))
+				// Sweep back over the move mobility_system made this step, which also starts a new collider at its spawn position
+				float length = std::sqrt(movement->vel_x * movement->vel_x + movement->vel_y * movement->vel_y);
+				if (length != 0)
 				{
-					++it2;
-					continue;
+					float dx = (float)(movement->vel_x / length * deltaTime * movement->speed);
+					float dy = (float)(movement->vel_y / length * deltaTime * movement->speed);
+					from = { to.min_x - dx, to.min_y - dy, to.max_x - dx, to.max_y - dy };
 				}
-				switch (it1->second.tag)
-				{
-				case 'a':
-				{
-					if (it2->second.tag == 'p')
-					{
-						reg.lifespans[it2->first] = { 0 };
-					}
-					if (it2->second.tag == 'b')
-					{
-						reg.lifespans[it1->first] = { 0 };
-						reg.lifespans[it2->first] = { 0 };
-					}
-					break;
-				}
-				case 'p':
-				{
-					if (it2->second.tag == 'a')
-					{
-						reg.lifespans[it1->first] = { 0 };
-					}
-					break;
-				}
-				case 'b':
+			}
+			if (collision.continuous)
+			{
+				last_boxes.emplace(id, { to, frame });
+			}
+			// The broad phase sees the whole path, so a collider crossing the path of a continuous one is found
+			colliders.push_back({ id, collision.layer, collision.continuous, from, to });
+			ids.push_back(id);
+			boxes.push_back(combine(from, to));
+			filters.push_back({ collision.layer, masks[layer_index(collision.layer)] });
+		});
+
+		// Forget the continuous colliders that were not seen this update
+		stale.clear();
+		for (std::size_t i = 0; i < last_boxes.size(); ++i)
+		{
+			if (last_boxes.components[i].frame != frame)
+			{
+				stale.push_back(last_boxes.entities[i]);
+			}
+		}
+		for (entity id : stale)
+		{
+			last_boxes.erase(id);
+		}
+
+		if (mode == broad_phase_all_pairs)
+		{
+			// Test every collider against all the ones after it with the overlap kernel
+			soa.assign(boxes);
+			for (std::uint32_t i = 0; i < colliders.size(); ++i)
+			{
+				hits.clear();
+				overlap_range(kernel, boxes[i], soa, i + 1, (std::uint32_t)colliders.size(), hits);
+				for (std::uint32_t j : hits)
 				{
-					if (it2->second.tag == 'a')
+					if (interacts(filters[i], filters[j]))
 					{
-						reg.lifespans[it2->first] = { 0 };
-						reg.lifespans[it1->first] = { 0 };
+						resolve(reg, colliders[i], colliders[j]);
 					}
-					break;
 				}
-				default:
-					break;
-				}
-				++it2;
 			}
-			++it1;
+			resolve_swept(reg);
+			return;
+		}
+		if (mode == broad_phase_sweep_and_prune)
+		{
+			sweep.find_pairs(ids, boxes, filters, pairs);
+		}
+		else if (mode == broad_phase_aabb_tree)
+		{
+			tree.find_pairs(ids, boxes, filters, pairs);
+		}
+		else
+		{
+			grid.find_pairs(boxes, filters, pairs);
+		}
+		for (const collision_pair& pair : pairs)
+		{
+			resolve(reg, colliders[pair.a], colliders[pair.b]);
+		}
+		resolve_swept(reg);
+	}
+
+	// Applies the response to a pair the broad phase found if the two colliders touch
+	// pairs of discrete colliders are tested at the end of the step, pairs with a continuous collider along both their paths,
+	// and those are only kept as swept hits until every pair is tested
+	void resolve(registry& reg, const collider& first, const collider& second)
+	{
+		++tested;
+		if (!first.continuous && !second.continuous)
+		{
+			if (overlaps(first.to, second.to))
+			{
+				respond(reg, first, second);
+			}
+			return;
+		}
+		float toi;
+		if (swept_overlaps(first.from, first.to, second.from, second.to, toi))
+		{
+			swept_hits.push_back({ first, second, toi });
+		}
+	}
+
+	// Applies the swept hits in the order they happen during the step
+	// a collider destroyed by an earlier hit takes part in no later one, so a bullet stops at the first asteroid on its path
+	// hits at the same time are ordered by their entities, so every broad phase ends in the same world
+	void resolve_swept(registry& reg)
+	{
+		if (swept_hits.empty())
+		{
+			return;
+		}
+		std::sort(swept_hits.begin(), swept_hits.end(), [](const swept_hit& a, const swept_hit& b)
+		{
+			if (a.toi != b.toi)
+			{
+				return a.toi < b.toi;
+			}
+			return std::make_pair(std::min(a.first.id, a.second.id), std::max(a.first.id, a.second.id)) < std::make_pair(std::min(b.first.id, b.second.id), std::max(b.first.id, b.second.id));
+		});
+		spent.clear();
+		for (const swept_hit& hit : swept_hits)
+		{
+			if (spent.contains(hit.first.id) || spent.contains(hit.second.id))
+			{
+				continue;
+			}
+			collision_response response = respond(reg, hit.first, hit.second);
+			if (response & response_destroy_first)
+			{
+				spent.emplace(hit.first.id, 1);
+			}
+			if (response & response_destroy_second)
+			{
+				spent.emplace(hit.second.id, 1);
+			}
 		}
 	}
+
+	// Records the response collision_matrix gives the layers of a touching pair and returns it
+	collision_response respond(registry& reg, const collider& first, const collider& second)
+	{
+		collision_response response = collision_matrix[layer_index(first.layer)][layer_index(second.layer)];
+		if (response & response_destroy_first)
+		{
+			reg.commands.assign<lifespan_component>(first.id, { 0 });
+		}
+		if (response & response_destroy_second)
+		{
+			reg.commands.assign<lifespan_component>(second.id, { 0 });
+		}
+		return response;
+	}
 };
 
 // asteroid_system spawns asteroids at regular intervals
@@ -315,31 +524,48 @@ struct collision_system
 // @param sdl is the memory adress of the SDL class
 struct asteroid_system
 {
+	// Writes the spawners, creates the asteroid entities and records their components
+	static system_access access()
+	{
+		return { 0, access_bit(asteroid_pool) | access_bit(entities_resource) | access_bit(commands_resource) };
+	}
+
 	void update(registry& reg, double deltaTime, SDL& sdl)
 	{
-		for (auto& it : reg.asteroids)
+		PROFILE_SCOPE("asteroid_system");
+		reg.view<asteroid_component>().each([&](entity id, asteroid_component& spawner)
 		{
-			it.second.spawn_timer -= deltaTime;
-			if (it.second.spawn_timer <= 0)
+			spawner.spawn_timer -= deltaTime;
+			if (spawner.spawn_timer <= 0)
 			{
-				it.second.spawn_timer = it.second.spawn_delay;
+				spawner.spawn_timer = spawner.spawn_delay;
+				if (!spawner.random.seeded())
+				{
+					spawner.random = reg.stream(id);
+				}
+				// Spawn anywhere along the side the lane starts from, the span is 1 for the axis the lane moves on
+				// and at least 1 for an asteroid about as large as the screen, bounded(0) would divide by zero
+				std::uint32_t span_x = std::max<std::uint32_t>(1, (std::uint32_t)std::abs((int)(1 + spawner.vel_y * (sdl.SCREEN_WIDTH - spawner.width))));
+				std::uint32_t span_y = std::max<std::uint32_t>(1, (std::uint32_t)std::abs((int)(1 + spawner.vel_x * (sdl.SCREEN_HEIGHT - spawner.height))));
+				float offset_x = (float)spawner.random.bounded(span_x);
+				float offset_y = (float)spawner.random.bounded(span_y);
 				entity asteroid = sdl.create_entity();
-				reg.collisions[asteroid] = { 'a' };
-				reg.sprites[asteroid] =
+				reg.commands.assign<collision_component>(asteroid, { layer_asteroid });
+				reg.commands.assign<sprite_component>(asteroid,
 				{
 					{
-						(sdl.SCREEN_WIDTH / 2) - (((sdl.SCREEN_WIDTH / 2) + it.second.width) * it.second.vel_x) + ((rand() % (int)(1 + it.second.vel_y * (sdl.SCREEN_WIDTH - it.second.width))) - ((sdl.SCREEN_WIDTH / 2) * abs(it.second.vel_y))),
-						(sdl.SCREEN_HEIGHT / 2) - (((sdl.SCREEN_HEIGHT / 2) + it.second.height) * it.second.vel_y) + ((rand() % (int)(1 + it.second.vel_x * (sdl.SCREEN_HEIGHT - it.second.height))) - ((sdl.SCREEN_HEIGHT / 2) * abs(it.second.vel_x))),
-						it.second.width,
-						it.second.height
+						(sdl.SCREEN_WIDTH / 2) - (((sdl.SCREEN_WIDTH / 2) + spawner.width) * spawner.vel_x) + (offset_x - ((sdl.SCREEN_WIDTH / 2) * abs(spawner.vel_y))),
+						(sdl.SCREEN_HEIGHT / 2) - (((sdl.SCREEN_HEIGHT / 2) + spawner.height) * spawner.vel_y) + (offset_y - ((sdl.SCREEN_HEIGHT / 2) * abs(spawner.vel_x))),
+						spawner.width,
+						spawner.height
 					},
 						sdl.textures[2],
 						0
-				};
-				reg.movements[asteroid] = { it.second.vel_x,it.second.vel_y,200 };
-				reg.lifespans[asteroid] = { 5 };
+				});
+				reg.commands.assign<movement_component>(asteroid, { spawner.vel_x,spawner.vel_y,spawner.speed });
+				reg.commands.assign<lifespan_component>(asteroid, { spawner.lifespan });
 			}
-		}
+		});
 	}
 };
 
@@ -347,82 +573,145 @@ struct asteroid_system
 // @param reg is the memory adress to the registry struct
 // @param sdl is the memory adress of the SDL class
 // @param player is the id of the player entity
-// @param e is the event variable used by SDL
+// @param input is the input snapshot of the tick
 struct input_system
 {
-	void update(registry& reg, entity player, SDL_Event& e, SDL& sdl)
+	// Reads the movements, the velocities and the sprites of the player, creates the bullets and records the changes
+	static system_access access()
 	{
-		if (e.type == SDL_KEYDOWN && e.key.repeat == 0)
+		return { access_bit(movement_pool) | access_bit(velocity_pool) | access_bit(sprite_pool), access_bit(entities_resource) | access_bit(commands_resource) };
+	}
+
+	void update(registry& reg, entity player, const input_snapshot& input, SDL& sdl)
+	{
+		PROFILE_SCOPE("input_system");
+		// Use direct movement while the toggle is held and velocity-based movement otherwise
+		if (input.down(action_toggle_mode))
 		{
-			switch (e.key.keysym.sym)
-			{
-			case SDLK_LSHIFT:
+			if (!reg.movements.contains(player) && reg.velocities.contains(player))
 			{
-				if (reg.movements.find(player) == reg.movements.end())
-				{
-					if (reg.velocities.find(player) != reg.velocities.end())
-					{
-						reg.velocities.erase(player);
-						reg.movements[player] = { 0,0, 200 };
-						return;
-					}
-				}
-			}
-			case SDLK_SPACE:
-			{
-				if (reg.sprites.find(player) == reg.sprites.end())
-				{
-					return;
-				}
-				entity bullet = sdl.create_entity();
-				int mouse_x, mouse_y;
-				SDL_GetMouseState(&mouse_x, &mouse_y);
-				float delta_x = mouse_x - (reg.sprites[player].src.x + (reg.sprites[player].src.w / 2));
-				float delta_y = mouse_y - (reg.sprites[player].src.y + (reg.sprites[player].src.h / 2));
-				float angle_deg = atan2(delta_y, delta_x) * 180.0 / M_PI;
-				float diff = sqrt(pow(delta_x, 2) + pow(delta_y, 2));
-				if (diff != 0)
-				{
-					delta_x /= diff;
-					delta_y /= diff;
-				}
-				reg.sprites[bullet] = { {reg.sprites[player].src.x + (reg.sprites[player].src.w / 2) - 7,reg.sprites[player].src.y + (reg.sprites[player].src.h / 2) - 5.5f,14,11} ,sdl.textures[1], angle_deg + 90 };
-				reg.movements[bullet] = { delta_x, delta_y, 700 };
-				reg.lifespans[bullet] = { 1 };
-				reg.collisions[bullet] = { 'b' };
+				reg.commands.remove<velocity_component>(player);
+				reg.commands.assign<movement_component>(player, { 0,0, 200 });
 			}
+		}
+		else if (!reg.velocities.contains(player) && reg.movements.contains(player))
+		{
+			float tempX = reg.movements.get(player).vel_x;
+			float tempY = reg.movements.get(player).vel_y;
+			float speed = reg.movements.get(player).speed;
+			float diff = sqrt(pow(tempX, 2) + pow(tempY, 2));
 
-			default:
-				return;
+			if (diff != 0)
+			{
+				tempX /= diff;
+				tempY /= diff;
 			}
+			reg.commands.remove<movement_component>(player);
+			reg.commands.assign<velocity_component>(player, { tempX * speed, tempY * speed, 0.5f, 600 });
 		}
-		if (e.type == SDL_KEYUP && e.key.repeat == 0)
+
+		// Fire a bullet towards the mouse
+		if (input.went_down(action_fire) && reg.sprites.contains(player))
 		{
-			switch (e.key.keysym.sym)
-			{
-			case SDLK_LSHIFT:
+			SDL_FRect origin = reg.sprites.get(player).src;
+			entity bullet = sdl.create_entity();
+			float delta_x = input.mouse_x - (origin.x + (origin.w / 2));
+			float delta_y = input.mouse_y - (origin.y + (origin.h / 2));
+			float angle_deg = atan2(delta_y, delta_x) * 180.0 / M_PI;
+			float diff = sqrt(pow(delta_x, 2) + pow(delta_y, 2));
+			if (diff != 0)
 			{
-				if (reg.velocities.find(player) == reg.velocities.end())
-				{
-					if (reg.movements.find(player) != reg.movements.end())
-					{
-						float tempX = reg.movements[player].vel_x;
-						float tempY = reg.movements[player].vel_y;
-						float speed = reg.movements[player].speed;
-						float diff = sqrt(pow(tempX, 2) + pow(tempY, 2));
-
-						if (diff != 0)
-						{
-							tempX /= diff;
-							tempY /= diff;
-						}
-						reg.movements.erase(player);
-						reg.velocities[player] = { tempX * speed, tempY * speed, 0.5f, 600 };
-						return;
-					}
-				}
-			}
+				delta_x /= diff;
+				delta_y /= diff;
 			}
+			reg.commands.assign<sprite_component>(bullet, { {origin.x + (origin.w / 2) - 7,origin.y + (origin.h / 2) - 5.5f,14,11} ,sdl.textures[1], angle_deg + 90 });
+			reg.commands.assign<movement_component>(bullet, { delta_x, delta_y, 700 });
+			reg.commands.assign<lifespan_component>(bullet, { 1 });
+			reg.commands.assign<collision_component>(bullet, { layer_bullet, true });
+
+			// Follow the press until the bullet reaches the screen
+			sdl.latency.fired(input.pressed_time[action_fire]);
+		}
+	}
+};
+
+// game_systems holds every system of the game and runs them as the schedule of a simulation tick
+// it is shared by the windowed game loop and the headless one so both simulate the same way
+struct game_systems
+{
+	mobility_system mobility_sys;
+	sprite_system sprite_sys;
+	controller_system controller_sys;
+	velocity_system velocity_sys;
+	rotation_system rotation_sys;
+	tracking_system tracking_sys;
+	lifespan_system lifespan_sys;
+	collision_system collision_sys;
+	asteroid_system asteroid_sys;
+	input_system input_sys;
+
+	// input_stg turns the key events of every tick into the snapshot the systems read
+	input_stage input_stg;
+
+	// schedule is the dependency graph of the systems of a tick, rebuilt every tick
+	system_scheduler schedule;
+
+	// pool runs the systems of a tick, started on the first tick with the threads SDL::systemThreads asks for
+	std::unique_ptr<thread_pool> pool;
+
+	// Applies the input of one tick, the same way for live play and for replays
+	// the events are drained into one snapshot, so the input systems run once per tick however many events arrived
+	// the two input systems are small and run serially
+	// @param sdl is the game the input belongs to
+	// @param input is the mouse position and the key events of the tick
+	void apply(SDL& sdl, const tick_input& input)
+	{
+		PROFILE_SCOPE("apply_input");
+		sdl.input = input_stg.update(input, sdl.controls);
+		sdl.latency.applied(input.events);
+		controller_sys.update(sdl.reg, sdl.input);
+		input_sys.update(sdl.reg, sdl.player, sdl.input, sdl);
+
+		// Apply the mode switch and the new bullet before the tick
+		sdl.reg.flush();
+	}
+
+	// Builds the schedule of one simulation tick, the systems in their serial order with the flushes as sync points
+	// @param sdl is the game to simulate
+	// @param step is the length of the tick in seconds
+	void plan(SDL& sdl, double step)
+	{
+		registry& reg = sdl.reg;
+		schedule.clear();
+		schedule.add("asteroid_system", asteroid_system::access(), [this, &reg, &sdl, step] { asteroid_sys.update(reg, step, sdl); });
+		schedule.add("velocity_system", velocity_system::access(), [this, &reg, step] { velocity_sys.update(reg, step); });
+		schedule.add("mobility_system", mobility_system::access(), [this, &reg, step] { mobility_sys.update(reg, step); });
+		schedule.add("collision_system", collision_system::access(), [this, &reg, step] { collision_sys.update(reg, step); });
+
+		// Apply spawned entities and collision results before lifespans are checked
+		schedule.add("flush", exclusive_access(), [&reg] { reg.flush(); });
+
+		schedule.add("lifespan_system", lifespan_system::access(), [this, &reg, step] { lifespan_sys.update(reg, step); });
+		schedule.add("tracking_system", tracking_system::access(), [this, &reg, &sdl] { tracking_sys.update(reg, sdl.input.mouse_x, sdl.input.mouse_y); });
+		schedule.add("rotation_system", rotation_system::access(), [this, &reg, step] { rotation_sys.update(reg, step); });
+
+		// Remove expired entities before they are drawn
+		schedule.add("flush", exclusive_access(), [&reg] { reg.flush(); });
+	}
+
+	// Runs one simulation tick, the systems that share nothing they write run at the same time
+	// @param sdl is the game to simulate
+	// @param step is the length of the tick in seconds
+	void tick(SDL& sdl, double step)
+	{
+		PROFILE_SCOPE("tick");
+		plan(sdl, step);
+		if (pool == nullptr)
+		{
+			// Use the threads asked for, or one per core up to the most systems that can run at once
+			int threads = sdl.systemThreads > 0 ? sdl.systemThreads : std::min((int)std::thread::hardware_concurrency(), schedule.width());
+			pool.reset(new thread_pool(std::max(threads, 1) - 1));
 		}
+		schedule.run(*pool);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,198 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <SDL.h>
+#include "stats.cpp"
+#include "replay.cpp"
+
+// fixed_timestep turns the real time between frames into a whole number of simulation ticks of equal length
+// the time left over is carried to the next frame, so the simulation advances at the tick rate whatever the frame rate
+struct fixed_timestep
+{
+	// tick_rate is the number of simulation ticks per second
+	double tick_rate = 60;
+	// max_steps is the most ticks run in one frame, time beyond it is dropped so a long stall
+	// slows the game down instead of making every later frame catch up
+	int max_steps = 5;
+	// accumulator is the real time not yet simulated, in seconds
+	double accumulator = 0;
+	// ticks counts the ticks run since the start
+	std::uint64_t ticks = 0;
+	// dropped is the real time thrown away by the catch-up limit, in seconds
+	double dropped = 0;
+
+	// Returns the length of a tick in seconds
+	double step() const
+	{
+		return 1.0 / tick_rate;
+	}
+
+	// Adds the real time of a frame and returns the number of ticks to run for it
+	// @param elapsed is the real time since the last frame in seconds
+	int advance(double elapsed)
+	{
+		accumulator += elapsed;
+		double dt = step();
+		int steps = (int)std::floor(accumulator / dt);
+		if (steps > max_steps)
+		{
+			steps = max_steps;
+		}
+		accumulator -= steps * dt;
+		if (accumulator >= dt)
+		{
+			// Keep the fraction of a tick so interpolation stays smooth, drop the rest
+			double excess = std::floor(accumulator / dt) * dt;
+			dropped += excess;
+			accumulator -= excess;
+		}
+		ticks += steps;
+		return steps;
+	}
+
+	// Returns how far the time left over reaches into the next tick, from 0 to 1, used to interpolate rendering
+	double alpha() const
+	{
+		return accumulator / step();
+	}
+};
+
+// frame_pacer holds the game loop to a target frame rate without keeping a core busy
+// it sleeps through most of the wait and spins only for the last stretch, since SDL_Delay may oversleep
+// by up to a scheduler tick, and records the time between frames to measure their jitter
+struct frame_pacer
+{
+	// target_fps is the frame rate to hold, 0 runs as fast as possible
+	double target_fps = 60;
+	// spin_seconds is how long before the deadline sleeping stops and spinning starts
+	double spin_seconds = 0.002;
+	// counter and sleep read the performance counter and sleep for milliseconds, a test can replace them with a simulated clock
+	Uint64 (SDLCALL *counter)(void) = SDL_GetPerformanceCounter;
+	void (SDLCALL *sleep)(Uint32) = SDL_Delay;
+	// frequency is the number of performance counter ticks per second
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	// deadline is the performance counter value at which the current frame should end
+	Uint64 deadline = 0;
+	// last is the performance counter value at the end of the last frame
+	Uint64 last = 0;
+	// late counts the frames that ended more than a whole frame after their deadline
+	std::size_t late = 0;
+	// frame_times holds the time between the ends of consecutive frames, in seconds
+	sample_stats frame_times;
+
+	// Starts timing from now, called once before the first frame
+	void start()
+	{
+		last = deadline = counter();
+	}
+
+	// Waits until the end of the current frame and records its length
+	void wait()
+	{
+		if (target_fps > 0)
+		{
+			Uint64 period = (Uint64)(frequency / target_fps);
+			deadline += period;
+			Uint64 now = counter();
+			if (now > deadline + period)
+			{
+				// Too far behind to catch up, start the schedule over from now
+				++late;
+				deadline = now;
+			}
+			else if (now < deadline)
+			{
+				double remaining = (double)(deadline - now) / frequency;
+				if (remaining > spin_seconds)
+				{
+					sleep((Uint32)((remaining - spin_seconds) * 1000));
+				}
+				while (counter() < deadline)
+				{
+				}
+			}
+		}
+		Uint64 now = counter();
+		frame_times.add((double)(now - last) / frequency);
+		last = now;
+	}
+};
+
+// input_latency measures how long key input takes from the moment the game drains it to the frame that shows its effect
+// the time an event spends in the queue before SDL_PollEvent is not visible to the game and not included
+struct input_latency
+{
+	// frequency is the number of performance counter ticks per second
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+	// queued is the time from draining an event to the start of the tick that applies it, in seconds
+	sample_stats queued;
+	// presented is the time from the tick that applies an event to the end of presenting its frame
+	sample_stats presented;
+	// total is the time from draining an event to the end of presenting the frame of its tick
+	sample_stats total;
+	// fire is the time from draining a fire press to the end of presenting the first frame with its bullet
+	sample_stats fire;
+
+	// in_flight holds the events applied to the simulation whose frame has not been presented yet
+	struct stamp
+	{
+		Uint64 drained;
+		Uint64 applied;
+		bool fire;
+	};
+	std::vector<stamp> in_flight;
+
+	// Notes the events of a tick as applied now, events without a drain time are skipped
+	// @param events are the events of the tick
+	void applied(const std::vector<input_event>& events)
+	{
+		Uint64 now = 0;
+		for (const input_event& event : events)
+		{
+			if (event.time != 0)
+			{
+				now = now != 0 ? now : SDL_GetPerformanceCounter();
+				in_flight.push_back({ event.time, now, false });
+			}
+		}
+	}
+
+	// Notes that a fire press created a bullet
+	// @param drained is the drain time of the press, 0 when unknown
+	void fired(Uint64 drained)
+	{
+		if (drained != 0)
+		{
+			in_flight.push_back({ drained, drained, true });
+		}
+	}
+
+	// Records the latency of everything in flight once its frame is presented
+	// @param now is the performance counter value after SDL_RenderPresent returned
+	void present(Uint64 now)
+	{
+		for (const stamp& s : in_flight)
+		{
+			double seconds = (double)(now - s.drained) / frequency;
+			if (s.fire)
+			{
+				fire.add(seconds);
+				continue;
+			}
+			queued.add((double)(s.applied - s.drained) / frequency);
+			presented.add((double)(now - s.applied) / frequency);
+			total.add(seconds);
+		}
+		in_flight.clear();
+	}
+
+	// Prints one of the measurements in milliseconds
+	// @param name names the measurement
+	// @param stats is the measurement
+	static void print(const char* name, const sample_stats& stats)
+	{
+		printf("latency %-9s events=%zu min=%.2f ms avg=%.2f ms p99=%.2f ms max=%.2f ms\n", name, stats.count, stats.min * 1e3, stats.mean * 1e3, stats.percentile(0.99) * 1e3, stats.max * 1e3);
+	}
+};
\ No newline at end of file